@@ -0,0 +1,153 @@
+#include "BernsteinBasis.hpp"
+
+#include <array>
+#include <vector>
+#include <algorithm>
+
+constexpr uint32_t BernsteinBasis::kBlockSize_;
+
+BernsteinBasis::BernsteinBasis(const uint32_t degree,
+	const std::vector<double>& parameterization_values) :
+		kDegree_{degree},
+		kNParameters_{static_cast<uint32_t>(parameterization_values.size())} {
+
+	const uint32_t P = kNParameters_;
+	const uint32_t n = kDegree_;
+	table_.assign((n + 1) * P, 0.0);
+
+	// Blocks of parameterization values, so the rows being updated
+	// stay in cache while the recurrence goes up to 'n'
+	for (uint32_t b0 = 0; b0 < P; b0 += kBlockSize_) {
+		const uint32_t b1 = std::min(P, b0 + kBlockSize_);
+		const double* t = parameterization_values.data();
+
+		double* r0 = table_.data();
+		for (uint32_t p = b0; p < b1; ++p) {
+			r0[p] = 1.0;
+		}
+
+		for (uint32_t k = 1; k <= n; ++k) {
+			// B(k,k) = t * B(k-1,k-1)
+			double* rk = &table_[k * P];
+			const double* rk1 = &table_[(k - 1) * P];
+			for (uint32_t p = b0; p < b1; ++p) {
+				rk[p] = t[p] * rk1[p];
+			}
+			// B(i,k) = (1 - t) * B(i,k-1) + t * B(i-1,k-1)
+			for (uint32_t i = k - 1; i > 0; --i) {
+				double* ri = &table_[i * P];
+				const double* ri1 = &table_[(i - 1) * P];
+				for (uint32_t p = b0; p < b1; ++p) {
+					ri[p] = (1 - t[p]) * ri[p] + t[p] * ri1[p];
+				}
+			}
+			// B(0,k) = (1 - t) * B(0,k-1)
+			for (uint32_t p = b0; p < b1; ++p) {
+				r0[p] = (1 - t[p]) * r0[p];
+			}
+		}
+	}
+}
+
+BernsteinBasis::~BernsteinBasis() {
+}
+
+void BernsteinBasis::evalCurve(const std::vector<Vec2d>& control_points,
+	std::vector<double>& out_x, std::vector<double>& out_y) const {
+	const uint32_t P = kNParameters_;
+	out_x.assign(P, 0.0);
+	out_y.assign(P, 0.0);
+	double* ox = out_x.data();
+	double* oy = out_y.data();
+	for (uint32_t i = 0; i <= kDegree_; ++i) {
+		const double* b = row(i);
+		const double vx = control_points[i][0];
+		const double vy = control_points[i][1];
+		for (uint32_t p = 0; p < P; ++p) {
+			ox[p] += b[p] * vx;
+			oy[p] += b[p] * vy;
+		}
+	}
+}
+
+void BernsteinBasis::evalCurve(const std::vector<Vec2d>& control_points,
+	const double parameterization_value, Vec2d& out) {
+	const double t = parameterization_value;
+	// Scratch for the in place steps, kept by the thread so a call in a
+	// loop doesn't allocate a copy of the control points each time
+	static thread_local std::vector<Vec2d> tmp;
+	tmp.assign(control_points.begin(), control_points.end());
+	if (tmp.empty()) {
+		return;
+	}
+	for (int r = tmp.size() - 1; r > 0; --r) {
+		for (int i = 0; i < r; ++i) {
+			tmp[i][0] = (1 - t) * tmp[i][0] + t * tmp[i+1][0];
+			tmp[i][1] = (1 - t) * tmp[i][1] + t * tmp[i+1][1];
+		}
+	}
+	out = tmp[0];
+}
+
+void BernsteinBasis::evalCurve(const std::vector<Vec2d>& control_points,
+	const std::vector<double>& parameterization_values,
+	std::vector<Vec2d>& out) {
+	const uint32_t P = parameterization_values.size();
+	const uint32_t N = control_points.size();
+	out.resize(P);
+	if (N == 0) {
+		return;
+	}
+
+	// One row per control point, one column per parameterization value
+	std::vector<double> tx(N * kBlockSize_);
+	std::vector<double> ty(N * kBlockSize_);
+
+	for (uint32_t b0 = 0; b0 < P; b0 += kBlockSize_) {
+		const uint32_t B = std::min(P - b0, kBlockSize_);
+		const double* t = parameterization_values.data() + b0;
+
+		for (uint32_t i = 0; i < N; ++i) {
+			std::fill_n(&tx[i * kBlockSize_], B, control_points[i][0]);
+			std::fill_n(&ty[i * kBlockSize_], B, control_points[i][1]);
+		}
+
+		for (uint32_t r = N - 1; r > 0; --r) {
+			for (uint32_t i = 0; i < r; ++i) {
+				double* x0 = &tx[i * kBlockSize_];
+				double* y0 = &ty[i * kBlockSize_];
+				const double* x1 = &tx[(i + 1) * kBlockSize_];
+				const double* y1 = &ty[(i + 1) * kBlockSize_];
+				for (uint32_t l = 0; l < B; ++l) {
+					x0[l] = (1 - t[l]) * x0[l] + t[l] * x1[l];
+					y0[l] = (1 - t[l]) * y0[l] + t[l] * y1[l];
+				}
+			}
+		}
+
+		for (uint32_t l = 0; l < B; ++l) {
+			out[b0 + l][0] = tx[l];
+			out[b0 + l][1] = ty[l];
+		}
+	}
+}
+
+void BernsteinBasis::splitCurve(const std::vector<Vec2d>& control_points,
+	const double parameterization_value,
+	std::vector<Vec2d>& left, std::vector<Vec2d>& right) {
+	const double t = parameterization_value;
+	const int n = control_points.size();
+	std::vector<Vec2d> tmp{control_points};
+	left.resize(n);
+	right.resize(n);
+	left[0] = tmp[0];
+	right[n-1] = tmp[n-1];
+	for (int r = n - 1; r > 0; --r) {
+		for (int i = 0; i < r; ++i) {
+			tmp[i][0] = (1 - t) * tmp[i][0] + t * tmp[i+1][0];
+			tmp[i][1] = (1 - t) * tmp[i][1] + t * tmp[i+1][1];
+		}
+		left[n - r] = tmp[0];
+		right[r - 1] = tmp[r - 1];
+	}
+}
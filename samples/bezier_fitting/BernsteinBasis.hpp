@@ -0,0 +1,68 @@
+#ifndef BERNSTEINBASIS_HPP_
+#define BERNSTEINBASIS_HPP_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+using Vec2d = std::array<double,2>;
+
+/*
+Bernstein basis of a given degree, tabulated for a fixed set of
+parameterization values.
+
+The table is built with the recurrence
+	B(i,k)(t) = (1 - t) * B(i,k-1)(t) + t * B(i-1,k-1)(t)
+so there are no binomials nor pow() calls, and it doesn't overflow
+for any degree.
+
+The table is stored by basis function: row 'i' holds B(i,n) for
+every parameterization value. That's the order used by the
+optimization cache (one control point against all the data points)
+and it lets the compiler vectorize the loops over the data points.
+*/
+struct BernsteinBasis {
+
+	const uint32_t kDegree_;
+	const uint32_t kNParameters_;
+
+	BernsteinBasis(const uint32_t degree,
+		const std::vector<double>& parameterization_values);
+
+	~BernsteinBasis();
+
+	// Basis function 'i' evaluated at every parameterization value
+	const double* row(const uint32_t i) const {
+		return &table_[i * kNParameters_];
+	}
+
+	double operator()(const uint32_t i, const uint32_t p) const {
+		return table_[i * kNParameters_ + p];
+	}
+
+	// Curve at every tabulated parameterization value
+	void evalCurve(const std::vector<Vec2d>& control_points,
+		std::vector<double>& out_x, std::vector<double>& out_y) const;
+
+	// de Casteljau evaluation of a single point
+	static void evalCurve(const std::vector<Vec2d>& control_points,
+		const double parameterization_value, Vec2d& out);
+
+	// de Casteljau evaluation of a batch of points, done in blocks so
+	// each step runs over many parameterization values at once
+	static void evalCurve(const std::vector<Vec2d>& control_points,
+		const std::vector<double>& parameterization_values,
+		std::vector<Vec2d>& out);
+
+	// de Casteljau subdivision, both halves describe the same curve
+	static void splitCurve(const std::vector<Vec2d>& control_points,
+		const double parameterization_value,
+		std::vector<Vec2d>& left, std::vector<Vec2d>& right);
+
+private:
+	static constexpr uint32_t kBlockSize_{256};
+
+	std::vector<double> table_;
+};
+
+#endif /* BERNSTEINBASIS_HPP_ */
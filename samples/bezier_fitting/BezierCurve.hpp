@@ -1,19 +1,15 @@
-
-
 #ifndef BEZIERCURVE_HPP_
 #define BEZIERCURVE_HPP_
 
 #include <array>
+#include <cstdint>
 #include <tuple>
 #include <vector>
 
-using Vec2d = std::array<double,2>;
+#include "BernsteinBasis.hpp"
 
 struct BezierCurve {
 
-	static constexpr int kMaxControlPoints{20};
-	std::array<std::array<double, kMaxControlPoints>, kMaxControlPoints> binomial_cache_;
-
 	const uint32_t kNumberControlPoints_;
 	const std::vector<std::tuple<double,Vec2d>> data_points_;
 	std::vector<Vec2d> control_points_;
@@ -27,6 +23,8 @@ struct BezierCurve {
 	~BezierCurve();
 
 	void getCurveInT(const double parameterization_value, Vec2d& out) const;
+	void getCurveInT(const std::vector<double>& parameterization_values,
+		std::vector<Vec2d>& out) const;
 	double calcError() const;
 
 
@@ -37,13 +35,13 @@ struct BezierCurve {
 	double calcErrorWithOptimizationCache(const Vec2d& candidate_cp);
 
 private:
+	// Basis tabulated at the data points' parameterization values
+	const BernsteinBasis basis_;
+
 	/* Optimization Cache */
 	uint32_t variable_control_point_;
-	std::vector<std::vector<double>> b_caching_;
-	std::vector<Vec2d> const_control_point_;
-
-
-	void initializeOptimizationCache();
+	std::vector<double> const_control_point_x_;
+	std::vector<double> const_control_point_y_;
 };
 
-#endif /* BEZIERCURVE_HPP_ */
\ No newline at end of file
+#endif /* BEZIERCURVE_HPP_ */
@@ -0,0 +1,410 @@
+#include "BezierSpline.hpp"
+
+#include <array>
+#include <tuple>
+#include <vector>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include "pdebc/SequentialDE.hpp"
+
+namespace {
+
+using SplineDE = pdebc::SequentialDE<double,2,double>;
+
+} // end anonymous namespace
+
+
+BezierSpline::BezierSpline(
+	const std::vector<Vec2d> data_points,
+	const uint32_t control_points_per_segment,
+	const double max_segment_error,
+	const uint32_t max_segments,
+	const Continuity continuity,
+	const uint32_t n_threads) :
+		// C1 fixes the control point next to each join, so at least
+		// one more is needed to fit the segment after the projection
+		kControlPointsPerSegment_{std::max<uint32_t>(
+			control_points_per_segment,
+			continuity == Continuity::C1 ? 5 : 3)},
+		kMaxSegmentError_{max_segment_error},
+		kMaxSegments_{std::max<uint32_t>(max_segments, 1)},
+		kContinuity_{continuity},
+		kNThreads_{std::max<uint32_t>(n_threads, 1)},
+		population_size_{32},
+		generations_per_fit_{64},
+		data_points_{data_points} {
+
+	using namespace std;
+	const int DP = data_points_.size();
+	if (DP < 2) {
+		throw invalid_argument("BezierSpline needs at least 2 data points");
+	}
+
+	// Chord length parameterization of the entire data set
+	chord_length_.resize(DP);
+	double td = 0;
+	chord_length_[0] = 0;
+	for (int i = 1; i < DP; i++) {
+		const double vdx = data_points_[i][0] - data_points_[i - 1][0];
+		const double vdy = data_points_[i][1] - data_points_[i - 1][1];
+		td += sqrt(vdx * vdx + vdy * vdy);
+		chord_length_[i] = td;
+	}
+	for (int i = 1; i < DP; i++) {
+		chord_length_[i] = td > 0 ? chord_length_[i] / td
+			: i / static_cast<double>(DP - 1);
+	}
+
+	// Start with a single straight segment
+	Segment s;
+	s.first = 0;
+	s.last = DP - 1;
+	s.control_points.resize(kControlPointsPerSegment_);
+	const Vec2d& a = data_points_[s.first];
+	const Vec2d& b = data_points_[s.last];
+	const int n = kControlPointsPerSegment_ - 1;
+	for (int i = 0; i <= n; i++) {
+		const double t = i / static_cast<double>(n);
+		s.control_points[i][0] = (1 - t) * a[0] + t * b[0];
+		s.control_points[i][1] = (1 - t) * a[1] + t * b[1];
+	}
+	s.error = 0;
+	s.dirty = true;
+	segments_.push_back(s);
+}
+
+BezierSpline::~BezierSpline() {
+}
+
+uint32_t BezierSpline::fit(const uint32_t max_refinements) {
+	uint32_t pass = 0;
+	for (;; ++pass) {
+		fitDirtySegments();
+		updateSegmentErrors();
+		// No split on the last pass, every segment stays fitted
+		if (pass == max_refinements || !splitSegments()) {
+			break;
+		}
+	}
+	return pass;
+}
+
+void BezierSpline::fitDirtySegments() {
+	using namespace std;
+
+	vector<uint32_t> dirty;
+	auto collectDirty = [this,&dirty]() {
+		dirty.clear();
+		for (uint32_t i = 0; i < this->segments_.size(); ++i) {
+			if (this->segments_[i].dirty) {
+				dirty.push_back(i);
+			}
+		}
+	};
+	collectDirty();
+
+	// Each worker takes the next dirty segment until there's none left.
+	// Segments only share their end points, which are never fitted, so
+	// they can all be fitted at the same time.
+	auto fitAll = [this,&dirty](const bool constrain_joins) {
+		atomic<uint32_t> next{0};
+		auto worker = [this,&dirty,&next,constrain_joins]() {
+			for (uint32_t k = next++; k < dirty.size(); k = next++) {
+				const uint32_t si = dirty[k];
+				Segment& s = this->segments_[si];
+				vector<bool> fixed_cp(s.control_points.size(), false);
+				fixed_cp.front() = true;
+				fixed_cp.back() = true;
+				if (constrain_joins) {
+					fixed_cp[1] = si > 0;
+					fixed_cp[fixed_cp.size() - 2] =
+						si + 1 < this->segments_.size();
+				}
+				this->fitSegment(s, fixed_cp);
+			}
+		};
+		const uint32_t nt = min<uint32_t>(kNThreads_, dirty.size());
+		vector<thread> threads;
+		for (uint32_t t = 1; t < nt; ++t) {
+			threads.push_back(thread(worker));
+		}
+		worker();
+		for (auto& t : threads) {
+			t.join();
+		}
+	};
+
+	fitAll(false);
+
+	if (kContinuity_ == Continuity::C1) {
+		enforceContinuity();
+		// The projection moved the control points around the joins (also
+		// of the clean neighbours, now dirty), so the remaining ones are
+		// fitted again with those fixed.
+		collectDirty();
+		fitAll(true);
+	}
+
+	for (auto i : dirty) {
+		segments_[i].dirty = false;
+	}
+}
+
+void BezierSpline::fitSegment(Segment& segment,
+	const std::vector<bool>& fixed_cp) {
+	using namespace std;
+
+	vector<uint32_t> variable_cps;
+	for (uint32_t i = 0; i < fixed_cp.size(); ++i) {
+		if (!fixed_cp[i]) {
+			variable_cps.push_back(i);
+		}
+	}
+	if (variable_cps.empty()) {
+		return;
+	}
+
+	BezierCurve curve{getSegmentData(segment), segment.control_points};
+
+	// The population is generated around the segment's data points
+	Vec2d lo = data_points_[segment.first];
+	Vec2d hi = lo;
+	for (uint32_t p = segment.first; p <= segment.last; ++p) {
+		for (int d = 0; d < 2; ++d) {
+			lo[d] = min(lo[d], data_points_[p][d]);
+			hi[d] = max(hi[d], data_points_[p][d]);
+		}
+	}
+	const double margin = max(max(hi[0] - lo[0], hi[1] - lo[1]), 1.0);
+
+	random_device rd;
+	vector<unique_ptr<SplineDE>> des;
+	for (auto cp : variable_cps) {
+		curve.updateVariableCPForOptimizationCache(cp);
+
+		// The generator doesn't know which coordinate it is generating,
+		// so both share the same range
+		mt19937 emt(rd());
+		uniform_real_distribution<double> ud(
+			min(lo[0], lo[1]) - margin, max(hi[0], hi[1]) + margin);
+		auto rand_domain = bind(ud, emt);
+
+		auto calc_error = [&curve](const array<double,2>& arr) -> double {
+			return curve.calcErrorWithOptimizationCache(arr);
+		};
+
+		auto error_evaluation = [](const double& a, const double& b) {
+			return a < b;
+		};
+
+		des.push_back(unique_ptr<SplineDE>(new SplineDE(
+			population_size_, 0.5, 0.8,
+			std::move(rand_domain),
+			std::move(calc_error),
+			std::move(error_evaluation))));
+	}
+
+	for (uint32_t g = 0; g < generations_per_fit_; ++g) {
+		for (uint32_t k = 0; k < variable_cps.size(); ++k) {
+			Vec2d& cp = curve.control_points_[variable_cps[k]];
+			curve.updateVariableCPForOptimizationCache(variable_cps[k]);
+			des[k]->solveOneGeneration();
+			// Keeps the warm start until DE finds something better
+			auto bc = des[k]->getBestCandidate();
+			if (get<0>(bc) < curve.calcErrorWithOptimizationCache(cp)) {
+				cp = get<1>(bc);
+			}
+		}
+	}
+
+	segment.control_points = curve.control_points_;
+}
+
+void BezierSpline::enforceContinuity() {
+	// Taken before the loop, so marking a neighbour doesn't cascade
+	std::vector<bool> fitted(segments_.size());
+	for (uint32_t k = 0; k < segments_.size(); ++k) {
+		fitted[k] = segments_[k].dirty;
+	}
+	for (uint32_t k = 0; k + 1 < segments_.size(); ++k) {
+		// Joins between clean segments are already smooth
+		if (!fitted[k] && !fitted[k+1]) {
+			continue;
+		}
+		std::vector<Vec2d>& p = segments_[k].control_points;
+		std::vector<Vec2d>& q = segments_[k+1].control_points;
+		const int n = p.size() - 1;
+		const Vec2d& join = p[n];
+		const double dk = getSegmentChordLength(segments_[k]);
+		const double dk1 = getSegmentChordLength(segments_[k+1]);
+		if (dk + dk1 <= 0) {
+			continue;
+		}
+
+		// Least squares tangent that keeps both derivatives equal:
+		//		(join - p[n-1]) / dk == (q[1] - join) / dk1 == v
+		const double w = dk * dk + dk1 * dk1;
+		Vec2d v;
+		for (int d = 0; d < 2; ++d) {
+			const double a = join[d] - p[n-1][d];
+			const double b = q[1][d] - join[d];
+			v[d] = (dk * a + dk1 * b) / w;
+		}
+		for (int d = 0; d < 2; ++d) {
+			p[n-1][d] = join[d] - dk * v[d];
+			q[1][d] = join[d] + dk1 * v[d];
+		}
+		segments_[k].dirty = true;
+		segments_[k+1].dirty = true;
+	}
+}
+
+void BezierSpline::updateSegmentErrors() {
+	for (auto& s : segments_) {
+		const auto data = getSegmentData(s);
+		Vec2d c;
+		s.error = 0;
+		for (uint32_t i = 0; i < data.size(); ++i) {
+			BernsteinBasis::evalCurve(s.control_points,
+				std::get<0>(data[i]), c);
+			const double dx = std::get<1>(data[i])[0] - c[0];
+			const double dy = std::get<1>(data[i])[1] - c[1];
+			s.error += dx * dx + dy * dy;
+		}
+	}
+}
+
+bool BezierSpline::splitSegments() {
+	using namespace std;
+	bool split = false;
+	vector<Segment> refined;
+	refined.reserve(segments_.size() * 2);
+
+	uint32_t n_segments = segments_.size();
+	for (auto& s : segments_) {
+		uint32_t sp = 0;
+		if (n_segments < kMaxSegments_
+			&& sqrt(s.error / (s.last - s.first + 1)) > kMaxSegmentError_) {
+			sp = findSplitPoint(s);
+		}
+		if (sp == 0) {
+			refined.push_back(s);
+			continue;
+		}
+
+		// Warm start: both halves describe the same curve as before.
+		// Same parameterization as getSegmentData(), by index when
+		// every point of the segment coincides.
+		const double a = chord_length_[s.first];
+		const double b = chord_length_[s.last];
+		const double t = b > a ? (chord_length_[sp] - a) / (b - a)
+			: (sp - s.first) / static_cast<double>(s.last - s.first);
+		Segment l, r;
+		BernsteinBasis::splitCurve(s.control_points, t,
+			l.control_points, r.control_points);
+		l.first = s.first;
+		l.last = sp;
+		r.first = sp;
+		r.last = s.last;
+		l.control_points.front() = data_points_[l.first];
+		l.control_points.back() = data_points_[l.last];
+		r.control_points.front() = data_points_[r.first];
+		r.control_points.back() = data_points_[r.last];
+		l.error = r.error = 0;
+		l.dirty = r.dirty = true;
+		refined.push_back(l);
+		refined.push_back(r);
+		++n_segments;
+		split = true;
+	}
+
+	segments_.swap(refined);
+	return split;
+}
+
+uint32_t BezierSpline::findSplitPoint(const Segment& segment) const {
+	// Both halves must keep enough data points to fit its control points
+	const uint32_t min_points = kControlPointsPerSegment_;
+	if (segment.last - segment.first + 2 < 2 * min_points) {
+		return 0;
+	}
+	// Outliers near the ends would only chop tiny segments off,
+	// so the split point is taken from the middle half.
+	const uint32_t quarter = (segment.last - segment.first) / 4;
+	const uint32_t lo = segment.first + std::max(min_points - 1, quarter);
+	const uint32_t hi = segment.last - std::max(min_points - 1, quarter);
+
+	// Split where the curve is further away from the data
+	const auto data = getSegmentData(segment);
+	uint32_t best = (lo + hi) / 2;
+	double best_error = -1;
+	Vec2d c;
+	for (uint32_t p = lo; p <= hi; ++p) {
+		const auto& dp = data[p - segment.first];
+		BernsteinBasis::evalCurve(segment.control_points, std::get<0>(dp), c);
+		const double dx = std::get<1>(dp)[0] - c[0];
+		const double dy = std::get<1>(dp)[1] - c[1];
+		const double e = dx * dx + dy * dy;
+		if (e > best_error) {
+			best_error = e;
+			best = p;
+		}
+	}
+	return best;
+}
+
+void BezierSpline::getCurveInT(const double parameterization_value,
+	Vec2d& out) const {
+	// Last segment that starts at or before the parameterization value
+	auto it = std::upper_bound(segments_.begin() + 1, segments_.end(),
+		parameterization_value,
+		[this](const double t, const Segment& s) {
+			return t < this->chord_length_[s.first];
+		});
+	const Segment& s = *(it - 1);
+	const double a = chord_length_[s.first];
+	const double b = chord_length_[s.last];
+	const double t = b > a ? (parameterization_value - a) / (b - a) : 0;
+	BernsteinBasis::evalCurve(s.control_points,
+		std::min(std::max(t, 0.0), 1.0), out);
+}
+
+double BezierSpline::calcError() const {
+	// Joins are interpolated, so counting them twice adds nothing
+	double error{0.0};
+	for (auto& s : segments_) {
+		error += s.error;
+	}
+	return error;
+}
+
+double BezierSpline::getSegmentRMSError(const uint32_t segment) const {
+	const Segment& s = segments_[segment];
+	return std::sqrt(s.error / (s.last - s.first + 1));
+}
+
+std::vector<std::tuple<double,Vec2d>> BezierSpline::getSegmentData(
+	const Segment& segment) const {
+	using namespace std;
+	vector<tuple<double,Vec2d>> data;
+	const double a = chord_length_[segment.first];
+	const double b = chord_length_[segment.last];
+	const uint32_t n = segment.last - segment.first;
+	for (uint32_t p = segment.first; p <= segment.last; ++p) {
+		const double t = b > a ? (chord_length_[p] - a) / (b - a)
+			: (p - segment.first) / static_cast<double>(n);
+		data.push_back(tuple<double,Vec2d>{t, data_points_[p]});
+	}
+	return data;
+}
+
+double BezierSpline::getSegmentChordLength(const Segment& segment) const {
+	return chord_length_[segment.last] - chord_length_[segment.first];
+}
@@ -0,0 +1,92 @@
+#ifndef BEZIERSPLINE_HPP_
+#define BEZIERSPLINE_HPP_
+
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "BezierCurve.hpp"
+
+/*
+Piecewise Bezier spline fitted with Differential Evolution.
+
+The data is split into segments, every segment is a BezierCurve whose
+first and last control points are data points shared with its
+neighbours (C0). Only the interior control points are fitted, each
+one by its own SequentialDE, and the segments are fitted in parallel.
+
+With Continuity::C1 the two control points around every join are
+projected on a common tangent after fitting, scaled by the chord
+length of each segment so the first derivative (in the global chord
+length parameterization) matches on both sides. The clean neighbours
+of a refitted segment are refitted too, and C1 takes at least 5
+control points per segment so one stays free after the projection.
+
+Refinement splits only the segments whose RMS error is above
+kMaxSegmentError_, so only those segments are fitted again.
+*/
+struct BezierSpline {
+
+	enum class Continuity {
+		C0,
+		C1
+	};
+
+	struct Segment {
+		uint32_t first; // index of the first data point
+		uint32_t last; // index of the last data point
+		std::vector<Vec2d> control_points;
+		double error; // sum of the squared errors
+		bool dirty; // needs to be fitted (again)
+	};
+
+	const uint32_t kControlPointsPerSegment_;
+	const double kMaxSegmentError_;
+	const uint32_t kMaxSegments_;
+	const Continuity kContinuity_;
+	const uint32_t kNThreads_;
+
+	uint32_t population_size_;
+	uint32_t generations_per_fit_;
+
+	const std::vector<Vec2d> data_points_;
+	std::vector<Segment> segments_;
+
+	BezierSpline(
+		const std::vector<Vec2d> data_points,
+		const uint32_t control_points_per_segment,
+		const double max_segment_error,
+		const uint32_t max_segments,
+		const Continuity continuity,
+		const uint32_t n_threads
+		);
+
+	~BezierSpline();
+
+	// Fits and refines the spline until every segment is below
+	// kMaxSegmentError_ or kMaxSegments_ is reached.
+	// Returns the number of refinement passes.
+	uint32_t fit(const uint32_t max_refinements);
+
+	// 'parameterization_value' is the global chord length, in [0,1].
+	void getCurveInT(const double parameterization_value, Vec2d& out) const;
+	double calcError() const;
+	double getSegmentRMSError(const uint32_t segment) const;
+
+private:
+	std::vector<double> chord_length_;
+
+	void fitDirtySegments();
+	void fitSegment(Segment& segment, const std::vector<bool>& fixed_cp);
+	void enforceContinuity();
+	void updateSegmentErrors();
+	bool splitSegments();
+	uint32_t findSplitPoint(const Segment& segment) const;
+
+	std::vector<std::tuple<double,Vec2d>> getSegmentData(
+		const Segment& segment) const;
+	double getSegmentChordLength(const Segment& segment) const;
+};
+
+#endif /* BEZIERSPLINE_HPP_ */
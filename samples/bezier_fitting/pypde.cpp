@@ -45,6 +45,28 @@ pypde::pypde(const int n_processes, const int population_size,
 			data_points_2dpos.push_back({{v.x,v.y}});
 	});
 
+	initialize(n_processes, population_size, bezier_control_points,
+		data_points_2dpos);
+}
+
+pypde::pypde(const int n_processes, const int population_size,
+		const int bezier_control_points,
+		const double* data_points, const int n_points, const int dim) {
+	using namespace std;
+	vector<Vec2d> data_points_2dpos(n_points);
+	for (int i = 0; i < n_points; i++) {
+		data_points_2dpos[i][0] = data_points[i * dim];
+		data_points_2dpos[i][1] = data_points[i * dim + 1];
+	}
+
+	initialize(n_processes, population_size, bezier_control_points,
+		data_points_2dpos);
+}
+
+void pypde::initialize(const int n_processes, const int population_size,
+		const int bezier_control_points,
+		const std::vector<Vec2d>& data_points_2dpos) {
+	using namespace std;
 	auto chord_length = calcChordLengthSwig(data_points_2dpos);
 
 	vector<std::tuple<double,Vec2d>> dp{};
@@ -90,22 +112,33 @@ pypde::pypde(const int n_processes, const int population_size,
 			std::move(calc_error),
 			std::move(error_evaluation)
 		));
+		best_errors_.push_back(get<0>(des_.back()->getBestCandidate()));
 	}
 }
 
 pypde::~pypde() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	stopSolve();
 	delete bezier_curve_;
 }
 
 
 void pypde::solveOneGeneration()  {
+	std::lock_guard<std::mutex> lock(mutex_);
+	stopSolve();
+	step();
+}
+
+void pypde::step() {
 	using namespace std;
 	for (int j = 0; j < des_.size(); ++j) {
 		bezier_curve_->updateVariableCPForOptimizationCache(j+1);
 		auto& d = des_[j];
 		d->solveOneGeneration();
 		//auto bc_error = get<0>(d.getBestCandidate());
-		auto bc_point = get<1>(d->getBestCandidate());
+		auto bc = d->getBestCandidate();
+		auto bc_point = get<1>(bc);
+		best_errors_[j] = get<0>(bc);
 		//printf("Best candidate middle control-point: (%g,%g)\n", bc_point[0], bc_point[1]);
 		//printf("Best Candidate error: %g\n", std::sqrt(bc_error));
 		bezier_curve_->control_points_[j+1] = bc_point;
@@ -113,13 +146,148 @@ void pypde::solveOneGeneration()  {
 }
 
 double pypde::getBestCandidateError(int i) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (solve_) {
+		return solve_->getBest().errors[i];
+	}
 	return std::get<0>(des_[i]->getBestCandidate());
 }
 
 std::vector<double> pypde::getBestCandidateCP(int i) {
+	std::lock_guard<std::mutex> lock(mutex_);
 	std::vector<double> v(2);
-	auto p = std::get<1>(des_[i]->getBestCandidate());
+	auto p = solve_ ? solve_->getBest().control_points[i + 1]
+		: std::get<1>(des_[i]->getBestCandidate());
 	v[0] = p[0];
 	v[1] = p[1];
 	return v;
-}
\ No newline at end of file
+}
+
+void pypde::solveNGenerations(const int n) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	stopSolve();
+	for (int g = 0; g < n; ++g) {
+		step();
+	}
+}
+
+void pypde::solveAsync(const int n) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	stopSolve();
+	solve_ = std::make_shared<pdebc::SolveHandle<PypdeBest>>(n,
+		[this]() {
+			this->step();
+		},
+		[this]() {
+			return PypdeBest{this->bezier_curve_->control_points_,
+				this->best_errors_};
+		});
+}
+
+// The handle is thread safe, so it's used without holding the mutex
+// (a long wait doesn't block the other calls).
+std::shared_ptr<pdebc::SolveHandle<PypdeBest>> pypde::currentSolve() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return solve_;
+}
+
+bool pypde::waitSolve(const double timeout) {
+	const auto solve = currentSolve();
+	if (!solve) {
+		return true;
+	}
+	if (timeout < 0) {
+		solve->wait();
+		return true;
+	}
+	return solve->waitFor(timeout);
+}
+
+void pypde::pauseSolve() {
+	if (const auto solve = currentSolve()) {
+		solve->pause();
+	}
+}
+
+void pypde::resumeSolve() {
+	if (const auto solve = currentSolve()) {
+		solve->resume();
+	}
+}
+
+void pypde::cancelSolve() {
+	if (const auto solve = currentSolve()) {
+		solve->cancel();
+	}
+}
+
+bool pypde::isSolving() const {
+	const auto solve = currentSolve();
+	return solve && !solve->isDone();
+}
+
+int pypde::getSolvedGenerations() const {
+	const auto solve = currentSolve();
+	return solve ? solve->getGenerations() : 0;
+}
+
+// Waits for the current generation of solveAsync(), if any. Called with
+// the mutex held. The run is waited for here, not in the handle's
+// destructor, since waitSolve() on another thread may still hold it.
+void pypde::stopSolve() {
+	if (solve_) {
+		solve_->cancel();
+		try {
+			solve_->wait();
+		} catch (...) {
+			// The failure of an abandoned run isn't reported
+		}
+		solve_.reset();
+	}
+}
+
+int pypde::getNumberOfCandidates() const {
+	return des_.size();
+}
+
+void pypde::getBestCandidatesError(double* errors, const int n) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (solve_) {
+		const auto best = solve_->getBest();
+		for (int i = 0; i < n && i < best.errors.size(); ++i) {
+			errors[i] = best.errors[i];
+		}
+		return;
+	}
+	for (int i = 0; i < n && i < des_.size(); ++i) {
+		errors[i] = std::get<0>(des_[i]->getBestCandidate());
+	}
+}
+
+void pypde::getBestCandidatesCP(double* cps, const int n, const int dim) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (solve_) {
+		const auto best = solve_->getBest();
+		for (int i = 0; i < n && i < des_.size(); ++i) {
+			cps[i * dim] = best.control_points[i + 1][0];
+			cps[i * dim + 1] = best.control_points[i + 1][1];
+		}
+		return;
+	}
+	for (int i = 0; i < n && i < des_.size(); ++i) {
+		auto p = std::get<1>(des_[i]->getBestCandidate());
+		cps[i * dim] = p[0];
+		cps[i * dim + 1] = p[1];
+	}
+}
+
+void pypde::getControlPoints(double* control_points, const int n,
+		const int dim) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	const auto& cps = solve_ ? solve_->getBest().control_points
+		: bezier_curve_->control_points_;
+	for (int i = 0; i < n && i < cps.size(); ++i) {
+		control_points[i * dim] = cps[i][0];
+		control_points[i * dim + 1] = cps[i][1];
+	}
+}
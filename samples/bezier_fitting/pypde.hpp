@@ -1,8 +1,10 @@
 
 #include <vector>
 #include <memory>
+#include <mutex>
 
 #include "pdebc/ThreadsDE.hpp"
+#include "pdebc/SolveHandle.hpp"
 #include "BezierCurve.hpp"
 
 struct Vec2 {
@@ -27,19 +29,75 @@ struct Vec2 {
 
 using PYPDE_ThreadsDE = pdebc::ThreadsDE<POPULATION_TYPE,POPULATION_DIM,ERROR_TYPE>;
 
+// Best so far of an asynchronous solve, copied after each generation
+struct PypdeBest {
+	std::vector<Vec2d> control_points;
+	std::vector<double> errors;
+};
+
 struct pypde {
 	BezierCurve* bezier_curve_;
 	std::vector<std::shared_ptr<PYPDE_ThreadsDE>> des_;
+	std::vector<double> best_errors_; // As of the last generation
 
 	pypde(const int n_processes, const int population_size,
 		const int bezier_control_points,
 		std::vector<Vec2> data_points);
 
+	// 'data_points' is a C contiguous (n_points x dim) array of doubles,
+	// read in place (dim must be 2).
+	pypde(const int n_processes, const int population_size,
+		const int bezier_control_points,
+		const double* data_points, const int n_points, const int dim);
+
 	~pypde();
 
 	void solveOneGeneration();
+	void solveNGenerations(const int n);
+
+	// Every call is safe from any Python thread: the solves and getters
+	// take turns, and the background run of solveAsync() is stopped
+	// before any other solve starts.
+
+	// Runs 'n' generations on a background thread, and returns at once.
+	// Meanwhile the getters below read the best so far (as of the last
+	// finished generation) without waiting. Any other solve cancels it
+	// first.
+	void solveAsync(const int n);
+	// Waits for the end of solveAsync(), for 'timeout' seconds at most
+	// (forever if negative). True if it is over.
+	bool waitSolve(const double timeout);
+	// Checked between generations
+	void pauseSolve();
+	void resumeSolve();
+	void cancelSolve();
+	bool isSolving() const;
+	int getSolvedGenerations() const;
+
+	int getNumberOfCandidates() const;
 
 	double getBestCandidateError(int i);
 
 	std::vector<double> getBestCandidateCP(int i);
+
+	// Batch getters, they write straight into the caller's buffers.
+	// 'errors' has getNumberOfCandidates() elements, 'cps' is
+	// (getNumberOfCandidates() x 2) and 'control_points' is
+	// (bezier_control_points x 2).
+	void getBestCandidatesError(double* errors, const int n);
+	void getBestCandidatesCP(double* cps, const int n, const int dim);
+	void getControlPoints(double* control_points, const int n, const int dim) const;
+
+private:
+	// Held by the solves and getters, and by anything reading 'solve_'
+	mutable std::mutex mutex_;
+	std::shared_ptr<pdebc::SolveHandle<PypdeBest>> solve_;
+
+	std::shared_ptr<pdebc::SolveHandle<PypdeBest>> currentSolve() const;
+
+	void step();
+	void stopSolve();
+	void initialize(const int n_processes, const int population_size,
+		const int bezier_control_points,
+		const std::vector<Vec2d>& data_points_2dpos);
 };
\ No newline at end of file
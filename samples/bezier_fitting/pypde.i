@@ -1,6 +1,44 @@
 %module pypde
 %{
+#include <cstring>
+
 #include "pypde.hpp"
+
+// Holds a Python buffer (e.g. a numpy array) for the duration of a
+// wrapped call, so its memory can be used in place.
+struct PyBufferView {
+	Py_buffer view;
+	bool acquired;
+
+	PyBufferView() : acquired{false} {
+	}
+	~PyBufferView() {
+		if (acquired) {
+			PyBuffer_Release(&view);
+		}
+	}
+
+	bool acquire(PyObject* obj, const int ndim, const int flags) {
+		if (PyObject_GetBuffer(obj, &view,
+				flags | PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+			return false;
+		}
+		acquired = true;
+		// "d", "<d", "=d" and "@d" are all native doubles here
+		const char* f = view.format;
+		const bool is_double = f != NULL && std::strlen(f) <= 2
+			&& f[std::strlen(f) - 1] == 'd'
+			&& view.itemsize == sizeof(double);
+		if (view.ndim != ndim || !is_double
+			|| (ndim == 2 && view.shape[1] != 2)) {
+			PyErr_SetString(PyExc_TypeError,
+				ndim == 2 ? "expected a C contiguous (n,2) array of doubles"
+				: "expected a C contiguous 1-D array of doubles");
+			return false;
+		}
+		return true;
+	}
+};
 %}
 
 %include "std_vector.i"
@@ -9,6 +47,57 @@ namespace std {
    %template(vectorv) vector<Vec2>;
 }
 
+/* Buffer protocol typemaps, no per element conversion */
+%typemap(in) (const double* IN_ARRAY2, int DIM1, int DIM2)
+		(PyBufferView buffer) {
+	if (!buffer.acquire($input, 2, PyBUF_SIMPLE)) {
+		SWIG_fail;
+	}
+	$1 = static_cast<const double*>(buffer.view.buf);
+	$2 = static_cast<int>(buffer.view.shape[0]);
+	$3 = static_cast<int>(buffer.view.shape[1]);
+}
+%typemap(typecheck, precedence=SWIG_TYPECHECK_DOUBLE_ARRAY)
+		(const double* IN_ARRAY2, int DIM1, int DIM2) {
+	$1 = PyObject_CheckBuffer($input) ? 1 : 0;
+}
+
+%typemap(in) (double* INPLACE_ARRAY1, int DIM1) (PyBufferView buffer) {
+	if (!buffer.acquire($input, 1, PyBUF_WRITABLE)) {
+		SWIG_fail;
+	}
+	$1 = static_cast<double*>(buffer.view.buf);
+	$2 = static_cast<int>(buffer.view.shape[0]);
+}
+
+%typemap(in) (double* INPLACE_ARRAY2, int DIM1, int DIM2)
+		(PyBufferView buffer) {
+	if (!buffer.acquire($input, 2, PyBUF_WRITABLE)) {
+		SWIG_fail;
+	}
+	$1 = static_cast<double*>(buffer.view.buf);
+	$2 = static_cast<int>(buffer.view.shape[0]);
+	$3 = static_cast<int>(buffer.view.shape[1]);
+}
+
+%apply (const double* IN_ARRAY2, int DIM1, int DIM2)
+	{(const double* data_points, int n_points, int dim)};
+%apply (double* INPLACE_ARRAY1, int DIM1)
+	{(double* errors, int n)};
+%apply (double* INPLACE_ARRAY2, int DIM1, int DIM2)
+	{(double* cps, int n, int dim)};
+%apply (double* INPLACE_ARRAY2, int DIM1, int DIM2)
+	{(double* control_points, int n, int dim)};
+
+/* Every call runs only C++ code, so other Python threads run meanwhile.
+   pypde has its own mutex, so the calls are safe from any thread, and a
+   getter waiting for a solve on another thread doesn't hold the GIL. */
+%exception {
+	Py_BEGIN_ALLOW_THREADS
+	$action
+	Py_END_ALLOW_THREADS
+}
+
 //%include "pypde.hpp"
 struct Vec2 {
 	double x;
@@ -23,8 +112,58 @@ struct pypde {
 	pypde(const int n_processes, const int population_size,
 		const int bezier_control_points,
 		std::vector<Vec2> data_points);
+	pypde(const int n_processes, const int population_size,
+		const int bezier_control_points,
+		const double* data_points, int n_points, int dim);
 	~pypde();
 	void solveOneGeneration();
+	void solveNGenerations(const int n);
+	void solveAsync(const int n);
+	bool waitSolve(const double timeout);
+	void pauseSolve();
+	void resumeSolve();
+	void cancelSolve();
+	bool isSolving() const;
+	int getSolvedGenerations() const;
+	int getNumberOfCandidates() const;
 	double getBestCandidateError(int i);
 	std::vector<double> getBestCandidateCP(int i);
-};
\ No newline at end of file
+	void getBestCandidatesError(double* errors, int n);
+	void getBestCandidatesCP(double* cps, int n, int dim);
+	void getControlPoints(double* control_points, int n, int dim) const;
+};
+
+%extend pypde {
+%pythoncode %{
+    def solveFor(self, seconds, max_generations=1000000000):
+        """Solves for 'seconds' at most (or 'max_generations'), then
+        returns the best control points so far, as a (n,2) numpy array.
+        Returns on time, the background run stops at the end of its
+        current generation."""
+        self.solveAsync(max_generations)
+        if not self.waitSolve(seconds):
+            self.cancelSolve()
+        return self.getControlPointsArray()
+
+    def getBestCandidatesErrorArray(self):
+        """Best error of every DE, as a numpy array."""
+        import numpy
+        out = numpy.empty(self.getNumberOfCandidates())
+        self.getBestCandidatesError(out)
+        return out
+
+    def getBestCandidatesCPArray(self):
+        """Best control point of every DE, as a (n,2) numpy array."""
+        import numpy
+        out = numpy.empty((self.getNumberOfCandidates(), 2))
+        self.getBestCandidatesCP(out)
+        return out
+
+    def getControlPointsArray(self):
+        """Every control point of the curve, as a (n,2) numpy array."""
+        import numpy
+        out = numpy.empty((self.getNumberOfCandidates() + 2, 2))
+        self.getControlPoints(out)
+        return out
+%}
+}
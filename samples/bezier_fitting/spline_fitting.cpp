@@ -0,0 +1,68 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+/*
+
+Bezier Spline Fitting Sample
+
+-> Fits a long noisy trace with a piecewise bezier spline
+-> Segments are split only where the error is too high
+
+*/
+
+
+#include <cstdio>
+#include <random>
+#include <array>
+#include <cmath>
+#include <vector>
+#include <thread>
+
+#include "BezierSpline.hpp"
+
+constexpr int DATA_POINTS {2000};
+constexpr double NOISE {0.05};
+constexpr double MAX_SEGMENT_ERROR {0.1};
+
+
+int main(int argc, char *argv[]) {
+	using namespace std;
+
+	/* a long noisy wave, way too long for a single bezier curve */
+	mt19937 emt(random_device{}());
+	normal_distribution<double> noise(0, NOISE);
+	vector<Vec2d> data_points;
+	for (int i = 0; i < DATA_POINTS; i++) {
+		const double x = i * 0.02;
+		data_points.push_back({{x + noise(emt), 3 * sin(x) + noise(emt)}});
+	}
+
+	BezierSpline spline{data_points, 5, MAX_SEGMENT_ERROR, 256,
+		BezierSpline::Continuity::C1, thread::hardware_concurrency()};
+
+	const uint32_t passes = spline.fit(16);
+
+	printf("Refinement passes: %u\n", passes);
+	printf("Segments: %zu\n", spline.segments_.size());
+	for (uint32_t i = 0; i < spline.segments_.size(); i++) {
+		const auto& s = spline.segments_[i];
+		printf("Segment %u: data points [%u,%u] RMS error: %g\n",
+			i, s.first, s.last, spline.getSegmentRMSError(i));
+	}
+	printf("Spline RMS error: %g\n",
+		std::sqrt(spline.calcError() / DATA_POINTS));
+}
@@ -0,0 +1,83 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+/*
+
+Process Pool Sample
+
+-> The error function lives in another program (stub_worker), like a
+	legacy simulator would
+-> ProcessEvaluatorPool keeps a few copies of it running, and DynamicDE
+	sends each generation to them in batches
+-> Usage: process_pool [path to stub_worker] [workers] [delay in ms]
+
+*/
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <tuple>
+
+#include "pdebc/DynamicDE.hpp"
+#include "pdebc/ProcessEvaluatorPool.hpp"
+
+constexpr int POPULATION_SIZE {64};
+constexpr int POPULATION_DIM {4};
+constexpr int GENERATIONS {500};
+
+constexpr double DOMAIN_LIMITS = 5;
+
+
+int main(int argc, char *argv[]) {
+  using pdebc::DynamicDE;
+  using pdebc::ProcessEvaluatorPool;
+  using namespace std;
+
+  const string worker = argc > 1 ? argv[1] : "./stub_worker";
+  const int n_workers = argc > 2 ? atoi(argv[2]) : 4;
+  const string delay_ms = argc > 3 ? argv[3] : "0";
+
+  random_device rd;
+  mt19937 emt(rd());
+  uniform_real_distribution<double> ud(-DOMAIN_LIMITS, +DOMAIN_LIMITS);
+  auto rand_domain = bind(ud, emt);
+
+  ProcessEvaluatorPool pool({worker, delay_ms}, n_workers, 8);
+
+  DynamicDE<double,double> de(POPULATION_DIM, POPULATION_SIZE, 0.9, 0.5,
+    rand_domain, pool.callback(),
+    [](const double& a, const double& b) { return a < b; });
+
+  for (int g = 0; g < GENERATIONS; ++g) {
+    de.solveOneGeneration();
+    if (g % 50 == 0) {
+      printf("Generation %d: %g\n", g, get<0>(de.getBestCandidate()));
+    }
+  }
+
+  auto best = de.getBestCandidate();
+  printf("Best error: %g\nBest candidate:", get<0>(best));
+  for (auto x : get<1>(best)) {
+    printf(" %f", x);
+  }
+  printf("\n");
+
+  return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+/*
+
+Stub Worker
+
+-> Stands in for an external simulator driven by ProcessEvaluatorPool
+-> Reads requests from stdin, writes the errors to stdout (see the
+	framing in ProcessEvaluatorPool.hpp)
+-> The error is the Rosenbrock function. The first argument is a delay
+	in milliseconds per candidate, to mimic an expensive evaluation
+
+*/
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+int main(int argc, char *argv[]) {
+  using namespace std;
+
+  const int delay_ms = argc > 1 ? atoi(argv[1]) : 0;
+
+  uint32_t header[2];
+  vector<double> candidates;
+  vector<double> errors;
+
+  // Ends when the solver closes our stdin
+  while (fread(header, sizeof(uint32_t), 2, stdin) == 2) {
+    const uint32_t n = header[0];
+    const uint32_t dim = header[1];
+    candidates.resize(n * dim);
+    errors.resize(n);
+    if (fread(candidates.data(), sizeof(double), n * dim, stdin) != n * dim) {
+      return 1;
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+      const double* x = &candidates[i * dim];
+      double e = 0;
+      for (uint32_t d = 0; d + 1 < dim; ++d) {
+        e += 100 * (x[d+1] - x[d]*x[d]) * (x[d+1] - x[d]*x[d])
+          + (1 - x[d]) * (1 - x[d]);
+      }
+      errors[i] = e;
+      if (delay_ms > 0) {
+        this_thread::sleep_for(chrono::milliseconds(delay_ms));
+      }
+    }
+
+    fwrite(&n, sizeof(uint32_t), 1, stdout);
+    fwrite(errors.data(), sizeof(double), n, stdout);
+    fflush(stdout);
+  }
+  return 0;
+}
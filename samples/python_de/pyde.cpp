@@ -0,0 +1,162 @@
+#include "pyde.hpp"
+
+#include <vector>
+#include <memory>
+#include <random>
+#include <tuple>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <chrono>
+
+#include "pdebc/DynamicDE.hpp"
+
+
+pyde::pyde(const int dim, const int population_size,
+		const double CR, const double F,
+		const double* lower, const int n_lower,
+		const double* upper, const int n_upper,
+		PyObject* fitness) : de_{nullptr}, fitness_{fitness} {
+	using namespace std;
+	if (dim < 1 || population_size < 4) {
+		PyErr_SetString(PyExc_ValueError,
+			"'dim' must be positive and 'population_size' at least 4");
+		throw PythonError{};
+	}
+	if (n_lower != dim || n_upper != dim) {
+		PyErr_SetString(PyExc_ValueError,
+			"lower and upper must have 'dim' elements");
+		throw PythonError{};
+	}
+	Py_INCREF(fitness_);
+
+	// population generator, each call goes to the next coordinate
+	// so every dimension gets its own bounds
+	auto t1 = chrono::high_resolution_clock::now().time_since_epoch();
+	mt19937 emt(chrono::duration_cast<chrono::nanoseconds>(t1).count());
+	uniform_real_distribution<double> ud(0.0, 1.0);
+	vector<double> lo(lower, lower + dim);
+	vector<double> hi(upper, upper + dim);
+	int d = 0;
+	auto rand_domain = [emt,ud,lo,hi,d]() mutable -> double {
+		const double r = lo[d] + ud(emt) * (hi[d] - lo[d]);
+		d = (d + 1) % lo.size();
+		return r;
+	};
+
+	auto error_evaluation = [](const double& a, const double& b) {
+		return a < b;
+	};
+
+	auto calc_errors = [this](const double* trials, uint32_t n,
+			uint32_t dim, double* errors) {
+		this->calcErrors(trials, n, dim, errors);
+	};
+
+	// The initial population is evaluated right away
+	try {
+		de_ = new PYDE_DynamicDE(dim, population_size, CR, F,
+			std::move(rand_domain),
+			std::move(calc_errors),
+			std::move(error_evaluation));
+	} catch (...) {
+		Py_DECREF(fitness_);
+		throw;
+	}
+}
+
+pyde::~pyde() {
+	delete de_;
+	Py_DECREF(fitness_);
+}
+
+void pyde::calcErrors(const double* trials, const uint32_t n,
+		const uint32_t dim, double* errors) {
+	// (n x dim) view of the trials, without copying them
+	PyObject* raw = PyMemoryView_FromMemory(
+		reinterpret_cast<char*>(const_cast<double*>(trials)),
+		n * dim * sizeof(double), PyBUF_READ);
+	if (raw == NULL) {
+		throw PythonError{};
+	}
+	PyObject* view = PyObject_CallMethod(raw, "cast", "s(II)", "d", n, dim);
+	Py_DECREF(raw);
+	if (view == NULL) {
+		throw PythonError{};
+	}
+
+	PyObject* result = PyObject_CallFunctionObjArgs(fitness_, view, NULL);
+
+	// The trials will change, nobody can keep looking at them
+	PyObject* released = PyObject_CallMethod(view, "release", NULL);
+	Py_DECREF(view);
+	if (result == NULL) {
+		Py_XDECREF(released);
+		throw PythonError{};
+	}
+	if (released == NULL) {
+		Py_DECREF(result);
+		PyErr_SetString(PyExc_RuntimeError,
+			"the fitness callback must not keep references to the trials");
+		throw PythonError{};
+	}
+	Py_DECREF(released);
+
+	Py_buffer buffer;
+	if (PyObject_GetBuffer(result, &buffer,
+			PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+		Py_DECREF(result);
+		throw PythonError{};
+	}
+	const char* f = buffer.format;
+	const bool ok = buffer.ndim == 1 && buffer.shape[0] == n
+		&& buffer.itemsize == sizeof(double)
+		&& f != NULL && std::strlen(f) > 0 && f[std::strlen(f) - 1] == 'd';
+	if (ok) {
+		std::memcpy(errors, buffer.buf, n * sizeof(double));
+	}
+	PyBuffer_Release(&buffer);
+	Py_DECREF(result);
+	if (!ok) {
+		PyErr_SetString(PyExc_TypeError,
+			"the fitness callback must return a 1-D float64 array "
+			"with one error per trial");
+		throw PythonError{};
+	}
+}
+
+void pyde::solveOneGeneration() {
+	de_->solveOneGeneration();
+}
+
+void pyde::solveNGenerations(const int n) {
+	de_->solveNGenerations(n);
+}
+
+int pyde::getDimension() const {
+	return de_->kDim_;
+}
+
+int pyde::getPopulationSize() const {
+	return de_->kPopSize_;
+}
+
+double pyde::getBestCandidateError() const {
+	return std::get<0>(de_->getBestCandidate());
+}
+
+void pyde::getBestCandidate(double* candidate, const int dim) const {
+	auto bc = std::get<1>(de_->getBestCandidate());
+	std::copy_n(bc.begin(), std::min<int>(dim, bc.size()), candidate);
+}
+
+void pyde::getPopulation(double* population, const int n,
+		const int dim) const {
+	const int count = std::min<int>(n * dim, de_->population_.size());
+	std::copy_n(de_->population_.begin(), count, population);
+}
+
+void pyde::getErrors(double* errors, const int n) const {
+	const auto& e = de_->getErrors();
+	std::copy_n(e.begin(), std::min<int>(n, e.size()), errors);
+}
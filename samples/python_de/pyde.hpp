@@ -0,0 +1,55 @@
+#ifndef PYDE_HPP_
+#define PYDE_HPP_
+
+#include <Python.h>
+
+#include <vector>
+#include <memory>
+
+#include "pdebc/DynamicDE.hpp"
+
+using PYDE_DynamicDE = pdebc::DynamicDE<double,double>;
+
+// Thrown when the Python fitness callback fails, the Python error
+// is still set so the wrapper just returns NULL.
+struct PythonError {
+};
+
+/*
+Generic Differential Evolution for Python.
+
+'fitness' is called once per generation with a (n x dim) float64
+memoryview of the trials and must return a 1-D float64 buffer of
+'n' errors (smaller is better).
+The memoryview points to the trials in place, so it is only valid
+during the call.
+*/
+struct pyde {
+	PYDE_DynamicDE* de_;
+	PyObject* fitness_;
+
+	pyde(const int dim, const int population_size,
+		const double CR, const double F,
+		const double* lower, const int n_lower,
+		const double* upper, const int n_upper,
+		PyObject* fitness);
+
+	~pyde();
+
+	void solveOneGeneration();
+	void solveNGenerations(const int n);
+
+	int getDimension() const;
+	int getPopulationSize() const;
+
+	double getBestCandidateError() const;
+	void getBestCandidate(double* candidate, const int dim) const;
+	void getPopulation(double* population, const int n, const int dim) const;
+	void getErrors(double* errors, const int n) const;
+
+private:
+	void calcErrors(const double* trials, const uint32_t n,
+		const uint32_t dim, double* errors);
+};
+
+#endif /* PYDE_HPP_ */
@@ -0,0 +1,148 @@
+%module pyde
+%{
+#include <cstring>
+
+#include "pyde.hpp"
+
+// Holds a Python buffer (e.g. a numpy array) for the duration of a
+// wrapped call, so its memory can be used in place.
+struct PyBufferView {
+	Py_buffer view;
+	bool acquired;
+
+	PyBufferView() : acquired{false} {
+	}
+	~PyBufferView() {
+		if (acquired) {
+			PyBuffer_Release(&view);
+		}
+	}
+
+	bool acquire(PyObject* obj, const int ndim, const int flags) {
+		if (PyObject_GetBuffer(obj, &view,
+				flags | PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+			return false;
+		}
+		acquired = true;
+		// "d", "<d", "=d" and "@d" are all native doubles here
+		const char* f = view.format;
+		const bool is_double = f != NULL && std::strlen(f) > 0
+			&& std::strlen(f) <= 2 && f[std::strlen(f) - 1] == 'd'
+			&& view.itemsize == sizeof(double);
+		if (view.ndim != ndim || !is_double) {
+			PyErr_SetString(PyExc_TypeError,
+				"expected a C contiguous array of doubles");
+			return false;
+		}
+		return true;
+	}
+};
+%}
+
+/* Buffer protocol typemaps, no per element conversion */
+%typemap(in) (const double* IN_ARRAY1, int DIM1) (PyBufferView buffer) {
+	if (!buffer.acquire($input, 1, PyBUF_SIMPLE)) {
+		SWIG_fail;
+	}
+	$1 = static_cast<const double*>(buffer.view.buf);
+	$2 = static_cast<int>(buffer.view.shape[0]);
+}
+
+%typemap(in) (double* INPLACE_ARRAY1, int DIM1) (PyBufferView buffer) {
+	if (!buffer.acquire($input, 1, PyBUF_WRITABLE)) {
+		SWIG_fail;
+	}
+	$1 = static_cast<double*>(buffer.view.buf);
+	$2 = static_cast<int>(buffer.view.shape[0]);
+}
+
+%typemap(in) (double* INPLACE_ARRAY2, int DIM1, int DIM2)
+		(PyBufferView buffer) {
+	if (!buffer.acquire($input, 2, PyBUF_WRITABLE)) {
+		SWIG_fail;
+	}
+	$1 = static_cast<double*>(buffer.view.buf);
+	$2 = static_cast<int>(buffer.view.shape[0]);
+	$3 = static_cast<int>(buffer.view.shape[1]);
+}
+
+%apply (const double* IN_ARRAY1, int DIM1)
+	{(const double* lower, int n_lower), (const double* upper, int n_upper)};
+%apply (double* INPLACE_ARRAY1, int DIM1)
+	{(double* candidate, int dim), (double* errors, int n)};
+%apply (double* INPLACE_ARRAY2, int DIM1, int DIM2)
+	{(double* population, int n, int dim)};
+
+/* The Python error is already set when the fitness callback fails */
+%exception {
+	try {
+		$action
+	} catch (const PythonError&) {
+		SWIG_fail;
+	}
+}
+
+struct pyde {
+	pyde(const int dim, const int population_size,
+		const double CR, const double F,
+		const double* lower, int n_lower,
+		const double* upper, int n_upper,
+		PyObject* fitness);
+	~pyde();
+	void solveOneGeneration();
+	void solveNGenerations(const int n);
+	int getDimension() const;
+	int getPopulationSize() const;
+	double getBestCandidateError() const;
+	void getBestCandidate(double* candidate, int dim) const;
+	void getPopulation(double* population, int n, int dim) const;
+	void getErrors(double* errors, int n) const;
+};
+
+%pythoncode %{
+class DE(object):
+    """Differential Evolution with a vectorized fitness function.
+
+    'fitness' receives every trial of a generation at once, as a
+    (population_size, dim) numpy array, and must return a 1-D array
+    with one error per trial (smaller is better). The array is only
+    valid during the call, copy it if it has to be kept.
+    """
+
+    def __init__(self, fitness, lower, upper,
+                 population_size=64, CR=0.5, F=0.8):
+        import numpy
+        self._numpy = numpy
+        lower = numpy.ascontiguousarray(lower, dtype=numpy.float64)
+        upper = numpy.ascontiguousarray(upper, dtype=numpy.float64)
+
+        def _fitness(trials):
+            errors = fitness(numpy.asarray(trials))
+            return numpy.ascontiguousarray(errors, dtype=numpy.float64)
+
+        self._de = pyde(len(lower), population_size, CR, F,
+                        lower, upper, _fitness)
+
+    def solveOneGeneration(self):
+        self._de.solveOneGeneration()
+
+    def solveNGenerations(self, n):
+        self._de.solveNGenerations(n)
+
+    def getBestCandidate(self):
+        """(error, candidate) of the best member of the population."""
+        out = self._numpy.empty(self._de.getDimension())
+        self._de.getBestCandidate(out)
+        return self._de.getBestCandidateError(), out
+
+    def getPopulation(self):
+        out = self._numpy.empty((self._de.getPopulationSize(),
+                                 self._de.getDimension()))
+        self._de.getPopulation(out)
+        return out
+
+    def getErrors(self):
+        out = self._numpy.empty(self._de.getPopulationSize())
+        self._de.getErrors(out)
+        return out
+%}
@@ -0,0 +1,31 @@
+"""
+Python DE Sample
+
+-> Minimizes the Rosenbrock function in 10 dimensions
+-> The fitness function gets the entire generation as a numpy
+	array, so there's a single Python call per generation
+"""
+
+import numpy
+
+from pyde import DE
+
+
+def rosenbrock(trials):
+    x = trials[:, :-1]
+    y = trials[:, 1:]
+    return numpy.sum(100.0 * (y - x * x) ** 2 + (1.0 - x) ** 2, axis=1)
+
+
+def main():
+    dim = 10
+    de = DE(rosenbrock, [-5.0] * dim, [5.0] * dim, population_size=128)
+    for g in range(50):
+        de.solveNGenerations(100)
+        error, candidate = de.getBestCandidate()
+        print("Generation %d: error %g" % ((g + 1) * 100, error))
+    print("Best candidate:", candidate)
+
+
+if __name__ == "__main__":
+    main()
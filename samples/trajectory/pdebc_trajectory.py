@@ -0,0 +1,107 @@
+"""
+Trajectory Reader
+
+-> Reads the files written by pdebc::TrajectoryLogger into numpy arrays
+-> Usage: python3 pdebc_trajectory.py [trajectory file]
+"""
+
+import sys
+
+import numpy
+
+MAGIC = b"PDEBCTRJ"
+VERSION = 1
+STATS = ("min", "p25", "median", "p75", "max", "mean")
+
+
+class Trajectory(object):
+    """
+    Columns, one row per logged generation:
+      generation (uint64), pop_size (uint32), best_error (float64),
+      best (float64, n x dim) and one float64 column per error statistic
+      (min, p25, median, p75, max and mean).
+    populations: list of (generation, errors, population) tuples, with the
+      population as a (size x dim) array.
+    """
+
+    def __init__(self, dim, columns, populations):
+        self.dim = dim
+        self.populations = populations
+        for name, column in columns.items():
+            setattr(self, name, column)
+
+    def __len__(self):
+        return len(self.generation)
+
+
+def _read(buf, offset, dtype, count):
+    a = numpy.frombuffer(buf, dtype=dtype, count=count, offset=offset)
+    return a, offset + a.nbytes
+
+
+def read(path):
+    with open(path, "rb") as f:
+        buf = f.read()
+    if buf[:8] != MAGIC:
+        raise ValueError("%s: not a trajectory file" % path)
+    (version, dim), offset = _read(buf, 8, numpy.uint32, 2)
+    if version != VERSION:
+        raise ValueError("%s: unknown version %d" % (path, version))
+    dim = int(dim)
+
+    blocks = {"generation": [], "pop_size": [], "best_error": [],
+              "best": [], "stats": []}
+    populations = []
+    while offset < len(buf):
+        (n,), offset = _read(buf, offset, numpy.uint32, 1)
+        n = int(n)
+        a, offset = _read(buf, offset, numpy.uint64, n)
+        blocks["generation"].append(a)
+        a, offset = _read(buf, offset, numpy.uint32, n)
+        blocks["pop_size"].append(a)
+        a, offset = _read(buf, offset, numpy.float64, n)
+        blocks["best_error"].append(a)
+        a, offset = _read(buf, offset, numpy.float64, n * dim)
+        blocks["best"].append(a.reshape(n, dim))
+        a, offset = _read(buf, offset, numpy.float64, n * len(STATS))
+        blocks["stats"].append(a.reshape(n, len(STATS)))
+
+        (n_populations,), offset = _read(buf, offset, numpy.uint32, 1)
+        for _ in range(int(n_populations)):
+            (generation,), offset = _read(buf, offset, numpy.uint64, 1)
+            (size,), offset = _read(buf, offset, numpy.uint32, 1)
+            errors, offset = _read(buf, offset, numpy.float64, int(size))
+            population, offset = _read(buf, offset, numpy.float64,
+                                       int(size) * dim)
+            populations.append((int(generation), errors,
+                                population.reshape(int(size), dim)))
+
+    columns = {}
+    for name in ("generation", "pop_size", "best_error"):
+        columns[name] = numpy.concatenate(blocks[name]) if blocks[name] \
+            else numpy.empty(0)
+    columns["best"] = numpy.concatenate(blocks["best"]) if blocks["best"] \
+        else numpy.empty((0, dim))
+    stats = numpy.concatenate(blocks["stats"]) if blocks["stats"] \
+        else numpy.empty((0, len(STATS)))
+    for i, name in enumerate(STATS):
+        columns[name] = stats[:, i]
+    return Trajectory(dim, columns, populations)
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else "trajectory.bin"
+    t = read(path)
+    print("%d generations, %d dimensions, %d populations"
+          % (len(t), t.dim, len(t.populations)))
+    for i in range(0, len(t), max(1, len(t) // 10)):
+        print("Generation %d: best %g, median %g, max %g"
+              % (t.generation[i], t.best_error[i], t.median[i], t.max[i]))
+    if t.populations:
+        generation, errors, population = t.populations[-1]
+        print("Last population (generation %d): %s, best %g"
+              % (generation, population.shape, errors.min()))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,87 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+/*
+
+Trajectory Sample
+
+-> Minimizes the Rosenbrock function with SequentialDE, saving every
+	generation to a trajectory file with TrajectoryLogger
+-> The best entity and the error distribution are saved every
+	generation, the entire population every 100 generations
+-> Read the file with pdebc_trajectory.py (needs numpy)
+-> Usage: trajectory [output file]
+
+*/
+
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <tuple>
+#include <array>
+
+#include "pdebc/SequentialDE.hpp"
+#include "pdebc/TrajectoryLogger.hpp"
+
+constexpr int POPULATION_SIZE {64};
+constexpr int POPULATION_DIM {8};
+constexpr int GENERATIONS {2000};
+constexpr int POPULATION_STRIDE {100};
+
+constexpr double DOMAIN_LIMITS = 5;
+
+
+int main(int argc, char *argv[]) {
+  using pdebc::SequentialDE;
+  using pdebc::TrajectoryLogger;
+  using namespace std;
+
+  const string path = argc > 1 ? argv[1] : "trajectory.bin";
+
+  random_device rd;
+  mt19937 emt(rd());
+  uniform_real_distribution<double> ud(-DOMAIN_LIMITS, +DOMAIN_LIMITS);
+  auto rand_domain = bind(ud, emt);
+
+  SequentialDE<double,POPULATION_DIM,double> de(POPULATION_SIZE, 0.9, 0.5,
+    rand_domain,
+    [](const array<double,POPULATION_DIM>& x) {
+      double error = 0;
+      for (int i = 0; i < POPULATION_DIM - 1; ++i) {
+        error += 100 * (x[i + 1] - x[i] * x[i]) * (x[i + 1] - x[i] * x[i])
+          + (1 - x[i]) * (1 - x[i]);
+      }
+      return error;
+    },
+    [](const double& a, const double& b) { return a < b; });
+
+  TrajectoryLogger logger(path, POPULATION_DIM, POPULATION_STRIDE);
+
+  for (int g = 0; g < GENERATIONS; ++g) {
+    de.solveOneGeneration();
+    logger.log(g, de.getBestCandidate(), de.getErrors(), de.getPopulation());
+    if (g % 200 == 0) {
+      printf("Generation %d: %g\n", g, get<0>(de.getBestCandidate()));
+    }
+  }
+  logger.close();
+
+  printf("Trajectory saved to %s\n", path.c_str());
+  return 0;
+}
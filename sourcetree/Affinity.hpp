@@ -0,0 +1,119 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef AFFINITY_HPP_
+#define AFFINITY_HPP_
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace pdebc {
+
+//! Size used to keep data written by different threads apart.
+constexpr std::size_t kCacheLineSize = 64;
+
+//! CPUs of each NUMA node.
+/*!
+	Read from /sys/devices/system/node. When that's not available
+	(or not Linux) every CPU is reported in a single node.
+*/
+inline std::vector<std::vector<int>> getNUMANodesCPUs() {
+	using namespace std;
+	vector<vector<int>> nodes;
+#ifdef __linux__
+	for (int n = 0; ; ++n) {
+		ifstream f("/sys/devices/system/node/node" + to_string(n) + "/cpulist");
+		if (!f) {
+			break;
+		}
+		// cpulist looks like "0-7,16-23"
+		vector<int> cpus;
+		string range;
+		while (getline(f, range, ',')) {
+			istringstream r(range);
+			int first, last;
+			char dash;
+			if (!(r >> first)) {
+				continue;
+			}
+			last = (r >> dash >> last) ? last : first;
+			for (int c = first; c <= last; ++c) {
+				cpus.push_back(c);
+			}
+		}
+		if (!cpus.empty()) {
+			nodes.push_back(cpus);
+		}
+	}
+#endif
+	if (nodes.empty()) {
+		nodes.push_back(vector<int>());
+		const int n = max(1u, thread::hardware_concurrency());
+		for (int c = 0; c < n; ++c) {
+			nodes[0].push_back(c);
+		}
+	}
+	return nodes;
+}
+
+//! One CPU per thread, spread in blocks over the NUMA nodes.
+/*!
+	Threads [0,k) go to the first node, [k,2k) to the second and so on,
+	so neighbour islands (which migrate to each other) share a node.
+	Pass the result to ThreadsDE as `cpu_affinity`.
+*/
+inline std::vector<int> getNUMAAffinity(const uint32_t n_threads) {
+	using namespace std;
+	const auto nodes = getNUMANodesCPUs();
+	vector<int> affinity(n_threads);
+	const uint32_t N = nodes.size();
+	for (uint32_t t = 0; t < n_threads; ++t) {
+		const uint32_t node = t * N / n_threads;
+		const uint32_t first = (node * n_threads + N - 1) / N;
+		const auto& cpus = nodes[node];
+		affinity[t] = cpus[(t - first) % cpus.size()];
+	}
+	return affinity;
+}
+
+//! Pins the calling thread to `cpu`.
+/*!
+	\return false if it failed or if it is not supported here.
+*/
+inline bool pinThisThread(const int cpu) {
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+} // end namespace pdebc
+
+#endif /* AFFINITY_HPP_ */
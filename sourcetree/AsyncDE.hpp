@@ -0,0 +1,504 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef ASYNCDE_HPP_
+#define ASYNCDE_HPP_
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <tuple>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <deque>
+#include <exception>
+#include <chrono>
+
+#include "BaseDE.hpp"
+#include "Crossover.hpp"
+
+namespace pdebc {
+
+//! Steady state Differential Evolution, without generation barriers.
+/*!
+	A fixed set of workers keeps taking the next target entity, builds its
+	trial from the current population, evaluates it and, if the trial wins,
+	replaces the target right away. Nobody waits for a slow evaluation: the
+	other workers go on with the next targets, so it fits error functions
+	whose cost varies a lot (simulations, external programs...).
+
+	A "generation" here is a budget of AsyncDE::kPopSize_ evaluations, so
+	solveNGenerations(N) returns after N * AsyncDE::kPopSize_ evaluations,
+	but the workers never synchronize between them.
+
+	Each entity has its own lock, held only to copy it or to replace it,
+	never during an evaluation. BaseDE::callback_calc_error_ is called by
+	many threads at once, so it must be thread safe.
+
+	The error function may also be asynchronous, returning a std::future
+	(e.g. a request to a server). Then each worker keeps
+	AsyncDE::kInFlight_ evaluations running, and selects each trial as
+	soon as its future is ready, so a few threads are enough to keep many
+	evaluations going.
+
+	\tparam POP_TYPE Population data type (usually 'double')
+	\tparam POP_DIM Population dimensions (usually 2D or 3D)
+	\tparam ERROR_TYPE Error type (usually 'double')
+*/
+template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
+struct AsyncDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
+
+	const uint32_t kNThreads_; ///< Number of workers.
+	const uint32_t kPopSize_; ///< Population size.
+	const uint32_t kInFlight_; ///< Evaluations in flight per worker (1 unless the error function is asynchronous).
+	const std::function<std::future<ERROR_TYPE>(const std::array<POP_TYPE,POP_DIM>&)>
+		callback_calc_error_async_; ///< Asynchronous error function, if any.
+	std::vector<std::array<POP_TYPE,POP_DIM>> population_; ///< Entire population. Only read it while no solve method is running.
+
+	/*!
+		\param n_threads Number of workers, each one runs an evaluation at a time.
+		\param POP_SIZE Population size. Must be at least 4, and should be
+			larger than `n_threads`.
+
+		\param CR Mutation rate. Determines the chances
+			of a mutation happening. This value must be
+			between [0,1].
+		\param F Mutation weight. Determines how much
+			the mutation impacts each trials. This value
+			should be between [0,1].
+		\param callback_population_generator Function used to generate each
+			entity of the population. It must return a POP_TYPE type and use no
+			parameters.
+		\param callback_calc_error Function used to calculate the error with a single
+			member of the population. It must be thread safe.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE. It
+			must return a bool. In case of true, the population from the first ERROR_TYPE
+			will be picked as best candidate.
+	*/
+	AsyncDE(const uint32_t n_threads, const uint32_t POP_SIZE,
+		const double CR, const double F,
+		const std::function<POP_TYPE()>&& callback_population_generator,
+		const std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_error,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation) :
+			BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE>(
+				CR, F,
+				std::move(callback_population_generator),
+				std::move(callback_calc_error),
+				std::move(callback_error_evaluation)),
+			kNThreads_{std::max<uint32_t>(1, n_threads)}, kPopSize_{POP_SIZE},
+			kInFlight_{1} {
+
+		initialize();
+	}
+
+	/*!
+		\param n_threads Number of workers.
+		\param POP_SIZE Population size.
+		\param CR Mutation rate.
+		\param F Mutation weight.
+		\param population_initializer Generates the entire initial population
+			inside its bounds. See PopulationInitializer.
+		\param callback_calc_error Function used to calculate the error with a single
+			member of the population. It must be thread safe.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE.
+	*/
+	AsyncDE(const uint32_t n_threads, const uint32_t POP_SIZE,
+		const double CR, const double F,
+		const PopulationInitializer<POP_TYPE,POP_DIM>& population_initializer,
+		const std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_error,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation) :
+			BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE>(
+				CR, F,
+				population_initializer,
+				std::move(callback_calc_error),
+				std::move(callback_error_evaluation)),
+			kNThreads_{std::max<uint32_t>(1, n_threads)}, kPopSize_{POP_SIZE},
+			kInFlight_{1} {
+
+		initialize();
+	}
+
+	/*!
+		\param n_threads Number of workers.
+		\param in_flight Evaluations each worker keeps running at once.
+		\param POP_SIZE Population size. Should be larger than
+			( `n_threads` * `in_flight` ).
+		\param CR Mutation rate.
+		\param F Mutation weight.
+		\param callback_population_generator Function used to generate each
+			entity of the population.
+		\param callback_calc_error_async Function that starts the calculation
+			of the error of a single member of the population, and returns its
+			future. It must be thread safe. A future that throws stops the solver
+			with that exception.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE.
+	*/
+	AsyncDE(const uint32_t n_threads, const uint32_t in_flight,
+		const uint32_t POP_SIZE, const double CR, const double F,
+		const std::function<POP_TYPE()>&& callback_population_generator,
+		const std::function<std::future<ERROR_TYPE>(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_error_async,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation) :
+			BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE>(
+				CR, F,
+				std::move(callback_population_generator),
+				syncCallback(callback_calc_error_async),
+				std::move(callback_error_evaluation)),
+			kNThreads_{std::max<uint32_t>(1, n_threads)}, kPopSize_{POP_SIZE},
+			kInFlight_{std::max<uint32_t>(1, in_flight)},
+			callback_calc_error_async_{callback_calc_error_async} {
+
+		initialize();
+	}
+
+	/*!
+		\param n_threads Number of workers.
+		\param in_flight Evaluations each worker keeps running at once.
+		\param POP_SIZE Population size.
+		\param CR Mutation rate.
+		\param F Mutation weight.
+		\param population_initializer Generates the entire initial population
+			inside its bounds. See PopulationInitializer.
+		\param callback_calc_error_async Function that starts the calculation
+			of the error of a single member of the population, and returns its
+			future. It must be thread safe.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE.
+	*/
+	AsyncDE(const uint32_t n_threads, const uint32_t in_flight,
+		const uint32_t POP_SIZE, const double CR, const double F,
+		const PopulationInitializer<POP_TYPE,POP_DIM>& population_initializer,
+		const std::function<std::future<ERROR_TYPE>(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_error_async,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation) :
+			BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE>(
+				CR, F,
+				population_initializer,
+				syncCallback(callback_calc_error_async),
+				std::move(callback_error_evaluation)),
+			kNThreads_{std::max<uint32_t>(1, n_threads)}, kPopSize_{POP_SIZE},
+			kInFlight_{std::max<uint32_t>(1, in_flight)},
+			callback_calc_error_async_{callback_calc_error_async} {
+
+		initialize();
+	}
+
+	~AsyncDE() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			finish_ = true;
+		}
+		cond_.notify_all();
+		for (auto& t : threads_) {
+			t.join();
+		}
+	}
+
+	//! Runs AsyncDE::kPopSize_ evaluations.
+	/*!
+		This is a blocking method.
+	*/
+	void solveOneGeneration() {
+		solveNEvaluations(kPopSize_);
+	}
+
+	//! Runs `N` * AsyncDE::kPopSize_ evaluations, without barriers between them.
+	void solveNGenerations(const uint32_t N) {
+		solveNEvaluations(static_cast<uint64_t>(N) * kPopSize_);
+	}
+
+	//! Runs `N` evaluations.
+	/*!
+		This is a blocking method. It returns when the `N` evaluations are
+		done and their selections committed.
+		If the error function throws, the evaluations already running are
+		finished and the exception is rethrown, now and by every later call.
+	*/
+	void solveNEvaluations(const uint64_t N) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (!error_) {
+			budget_ += N;
+			cond_.notify_all();
+			done_cond_.wait(lock, [this]() {return this->done_ == this->budget_;});
+		}
+		if (error_) {
+			std::rethrow_exception(error_);
+		}
+	}
+
+	//! Number of evaluations done so far (the initial population excluded).
+	uint64_t getEvaluations() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return done_;
+	}
+
+	/*!
+		This operation has an O(N) complexity, where N is the population size.
+	*/
+	std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>> getBestCandidate() {
+		auto e = std::min_element(pop_errors_.begin(), pop_errors_.end(),
+			this->callback_error_evaluation_);
+		auto min = std::distance(pop_errors_.begin(), e);
+
+		return std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>>{
+			pop_errors_[min],population_[min]};
+	}
+
+private:
+	std::vector<ERROR_TYPE> pop_errors_;
+	const BinomialCrossover<POP_TYPE,POP_DIM> crossover_{this->kCR_};
+	std::unique_ptr<std::mutex[]> entity_locks_;
+	std::atomic<uint64_t> next_target_{0};
+
+	std::vector<std::thread> threads_;
+	mutable std::mutex mutex_;
+	std::condition_variable cond_;
+	std::condition_variable done_cond_;
+	uint64_t budget_{0}; // Evaluations requested
+	uint64_t claimed_{0}; // Evaluations taken by a worker
+	uint64_t done_{0}; // Evaluations committed
+	bool finish_{false};
+	std::exception_ptr error_; // Thrown by an error function, stops the solver
+
+	// An evaluation started by a worker
+	struct Pending {
+		uint32_t index;
+		std::array<POP_TYPE,POP_DIM> candidate;
+		std::future<ERROR_TYPE> error;
+	};
+
+	// BaseDE::callback_calc_error_ of the asynchronous constructors
+	static std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>
+		syncCallback(const std::function<std::future<ERROR_TYPE>(
+			const std::array<POP_TYPE,POP_DIM>&)>& callback) {
+		return [callback](const std::array<POP_TYPE,POP_DIM>& x) {
+			return callback(x).get();
+		};
+	}
+
+	void initialize() {
+		using namespace std;
+		population_.resize(kPopSize_);
+		pop_errors_.resize(kPopSize_);
+		entity_locks_.reset(new mutex[kPopSize_]);
+
+		if (this->population_initializer_) {
+			this->population_initializer_->generate(population_);
+		} else {
+			for (uint32_t i = 0; i < kPopSize_; ++i) {
+				for (int d = 0; d < POP_DIM; ++d) {
+					population_[i][d] = this->callback_population_generator_();
+				}
+			}
+		}
+		calcErrors(population_, pop_errors_);
+
+		if (this->population_initializer_
+			&& this->population_initializer_->kOpposition_) {
+			oppositionSelection();
+		}
+
+		random_device rd;
+		for (uint32_t t = 0; t < kNThreads_; ++t) {
+			threads_.push_back(thread(&AsyncDE::run, this, rd()));
+		}
+	}
+
+	// Before the workers start: threads take the next entity as they get free
+	void calcErrors(const std::vector<std::array<POP_TYPE,POP_DIM>>& population,
+		std::vector<ERROR_TYPE>& errors) {
+		if (callback_calc_error_async_) {
+			// Same number of evaluations in flight as the workers will have
+			const uint32_t window = kNThreads_ * kInFlight_;
+			std::deque<std::future<ERROR_TYPE>> futures;
+			uint32_t first = 0;
+			for (uint32_t i = 0; i < population.size(); ++i) {
+				if (futures.size() == window) {
+					errors[first++] = futures.front().get();
+					futures.pop_front();
+				}
+				futures.push_back(callback_calc_error_async_(population[i]));
+			}
+			for (auto& f : futures) {
+				errors[first++] = f.get();
+			}
+			return;
+		}
+		std::atomic<uint32_t> next{0};
+		auto work = [this,&population,&errors,&next]() {
+			for (uint32_t i = next++; i < population.size(); i = next++) {
+				errors[i] = this->callback_calc_error_(population[i]);
+			}
+		};
+		std::vector<std::thread> threads;
+		for (uint32_t t = 1; t < kNThreads_; ++t) {
+			threads.push_back(std::thread(work));
+		}
+		work();
+		for (auto& t : threads) {
+			t.join();
+		}
+	}
+
+	// Evaluates the opposite of every entity and keeps the best
+	// kPopSize_ of both populations
+	void oppositionSelection() {
+		using namespace std;
+		vector<array<POP_TYPE,POP_DIM>> opposites(kPopSize_);
+		vector<ERROR_TYPE> opposite_errors(kPopSize_);
+		for (uint32_t i = 0; i < kPopSize_; ++i) {
+			opposites[i] = this->population_initializer_->opposite(population_[i]);
+		}
+		calcErrors(opposites, opposite_errors);
+
+		PopulationInitializer<POP_TYPE,POP_DIM>::selectOpposition(population_,
+			pop_errors_, opposites, opposite_errors,
+			this->callback_error_evaluation_);
+	}
+
+	void run(const std::mt19937::result_type seed) {
+		using namespace std;
+		mt19937_64 emt(seed); // 64 bits, see BinomialCrossover
+		deque<Pending> pending;
+		for (;;) {
+			// Start evaluations until kInFlight_ are running. It only
+			// blocks for more budget when there's nothing to wait for.
+			while (pending.size() < kInFlight_) {
+				unique_lock<mutex> lock(mutex_);
+				if (pending.empty()) {
+					cond_.wait(lock, [this]() {
+						return this->finish_ || this->claimed_ < this->budget_;
+					});
+				}
+				if (finish_) {
+					return;
+				}
+				if (claimed_ == budget_) {
+					break;
+				}
+				++claimed_;
+				lock.unlock();
+
+				const uint32_t i = next_target_++ % kPopSize_;
+				Pending p{i, mutation(i, emt), future<ERROR_TYPE>()};
+				if (callback_calc_error_async_) {
+					p.error = callback_calc_error_async_(p.candidate);
+				} else {
+					promise<ERROR_TYPE> ready;
+					try {
+						ready.set_value(this->callback_calc_error_(p.candidate));
+					} catch (...) {
+						ready.set_exception(current_exception());
+					}
+					p.error = ready.get_future();
+				}
+				pending.push_back(std::move(p));
+			}
+
+			// Selects every finished evaluation, or waits for the oldest
+			bool any = false;
+			for (auto it = pending.begin(); it != pending.end(); ) {
+				if (it->error.wait_for(chrono::seconds(0))
+					== future_status::ready) {
+					complete(*it);
+					it = pending.erase(it);
+					any = true;
+				} else {
+					++it;
+				}
+			}
+			if (!any) {
+				pending.front().error.wait();
+				complete(pending.front());
+				pending.pop_front();
+			}
+		}
+	}
+
+	void complete(Pending& p) {
+		using namespace std;
+		try {
+			select(p.index, p.candidate, p.error.get());
+		} catch (...) {
+			// The evaluations not started yet are cancelled
+			lock_guard<mutex> lock(mutex_);
+			if (!error_) {
+				error_ = current_exception();
+			}
+			budget_ = claimed_;
+		}
+		lock_guard<mutex> lock(mutex_);
+		if (++done_ == budget_) {
+			done_cond_.notify_all();
+		}
+	}
+
+	std::array<POP_TYPE,POP_DIM> readEntity(const uint32_t i) const {
+		std::lock_guard<std::mutex> lock(entity_locks_[i]);
+		return population_[i];
+	}
+
+	// DE/rand/1/bin over the current population
+	std::array<POP_TYPE,POP_DIM> mutation(const uint32_t actual_index,
+		std::mt19937_64& emt) {
+		using namespace std;
+		uniform_int_distribution<uint32_t> ui(0, kPopSize_-1);
+		uniform_int_distribution<uint32_t> uj(0, POP_DIM-1);
+
+		const int j = uj(emt);
+
+		const uint32_t it0 = ui(emt);
+		uint32_t it1 = ui(emt);
+		while (it1 == it0) {
+			it1 = ui(emt);
+		}
+		uint32_t it2 = ui(emt);
+		while (it2 == it1 || it2 == it0) {
+			it2 = ui(emt);
+		}
+
+		const array<POP_TYPE,POP_DIM> a = readEntity(it0);
+		const array<POP_TYPE,POP_DIM> b = readEntity(it1);
+		const array<POP_TYPE,POP_DIM> c = readEntity(it2);
+		const array<POP_TYPE,POP_DIM> x = readEntity(actual_index);
+		array<POP_TYPE,POP_DIM> candidate;
+
+		const MutationType<POP_TYPE> F = static_cast<MutationType<POP_TYPE>>(this->kF_);
+		crossover_.apply(emt, j, F, a, b, c, x, candidate);
+		return candidate;
+	}
+
+	// Compared against the target as it is now, another
+	// worker may have replaced it during the evaluation
+	void select(const uint32_t actual_index,
+		const std::array<POP_TYPE,POP_DIM>& candidate,
+		const ERROR_TYPE& error_new) {
+		std::lock_guard<std::mutex> lock(entity_locks_[actual_index]);
+		if (this->callback_error_evaluation_(error_new, pop_errors_[actual_index])) {
+			population_[actual_index] = candidate;
+			pop_errors_[actual_index] = error_new;
+		}
+	}
+};
+
+} // end namespace pdebc
+
+#endif /* ASYNCDE_HPP_ */
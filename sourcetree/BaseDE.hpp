@@ -19,8 +19,13 @@
 #ifndef BASEDE_H_
 #define BASEDE_H_
 
+#include <array>
 #include <functional>
+#include <memory>
 #include <tuple>
+#include <type_traits>
+
+#include "PopulationInitializer.hpp"
 
 //! pdebc namespace
 /*!
@@ -28,6 +33,68 @@
 */
 namespace pdebc {
 
+//! Type of the mutation arithmetic of a POP_TYPE population.
+/*!
+	POP_TYPE itself for floating point types, so a `float` population is
+	mutated in single precision, without going through double (twice the
+	SIMD width). double for integer types, truncated when stored.
+*/
+template <class POP_TYPE>
+using MutationType = typename std::conditional<
+	std::is_floating_point<POP_TYPE>::value, POP_TYPE, double>::type;
+
+//! Engines' configurations compiled into the library.
+/*!
+	libpdebc carries explicit instantiations of SequentialDE, ThreadsDE
+	(and its solver) for `double` and `float` populations (with errors
+	of the same type) of 1 to 16 dimensions, and of DynamicDE for
+	`double` and `float`. The headers declare them `extern template`, so
+	the programs using them don't compile them again, they link them.
+
+	Define PDEBC_NO_EXTERN_TEMPLATES to compile them in every translation
+	unit instead (e.g. when not linking libpdebc). PDEBC_ENABLE_TRACE
+	implies it, the library is built without tracing.
+*/
+#if !defined(PDEBC_NO_EXTERN_TEMPLATES) && !defined(PDEBC_ENABLE_TRACE)
+#define PDEBC_EXTERN_TEMPLATES
+#endif
+
+/// \cond DEV
+// Calls MACRO(POP_TYPE, POP_DIM, ERROR_TYPE) for the dimensions of
+// RANGE (1_8 or 9_16). The library instantiates each value type and
+// range in its own translation unit, so they compile in parallel.
+#define PDEBC_FOR_EACH_DIM(MACRO, POP_TYPE, ERROR_TYPE, RANGE) \
+	PDEBC_FOR_EACH_DIM_##RANGE(MACRO, POP_TYPE, ERROR_TYPE)
+
+#define PDEBC_FOR_EACH_DIM_1_8(MACRO, POP_TYPE, ERROR_TYPE) \
+	MACRO(POP_TYPE,1,ERROR_TYPE) \
+	MACRO(POP_TYPE,2,ERROR_TYPE) \
+	MACRO(POP_TYPE,3,ERROR_TYPE) \
+	MACRO(POP_TYPE,4,ERROR_TYPE) \
+	MACRO(POP_TYPE,5,ERROR_TYPE) \
+	MACRO(POP_TYPE,6,ERROR_TYPE) \
+	MACRO(POP_TYPE,7,ERROR_TYPE) \
+	MACRO(POP_TYPE,8,ERROR_TYPE)
+
+#define PDEBC_FOR_EACH_DIM_9_16(MACRO, POP_TYPE, ERROR_TYPE) \
+	MACRO(POP_TYPE,9,ERROR_TYPE) \
+	MACRO(POP_TYPE,10,ERROR_TYPE) \
+	MACRO(POP_TYPE,11,ERROR_TYPE) \
+	MACRO(POP_TYPE,12,ERROR_TYPE) \
+	MACRO(POP_TYPE,13,ERROR_TYPE) \
+	MACRO(POP_TYPE,14,ERROR_TYPE) \
+	MACRO(POP_TYPE,15,ERROR_TYPE) \
+	MACRO(POP_TYPE,16,ERROR_TYPE)
+
+// Calls MACRO(POP_TYPE, POP_DIM, ERROR_TYPE) for every configuration
+// instantiated in the library
+#define PDEBC_FOR_EACH_INSTANCE(MACRO) \
+	PDEBC_FOR_EACH_DIM(MACRO, double, double, 1_8) \
+	PDEBC_FOR_EACH_DIM(MACRO, double, double, 9_16) \
+	PDEBC_FOR_EACH_DIM(MACRO, float, float, 1_8) \
+	PDEBC_FOR_EACH_DIM(MACRO, float, float, 9_16)
+/// \endcond
+
 //! Abstract/base class for every Differential Evolution class.
 /*!
 	BaseDE offers a generic interface for any DE class.
@@ -51,6 +118,8 @@ struct BaseDE {
 		callback_calc_error_; ///< Callback for the error calculator function.
 	const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>
 		callback_error_evaluation_; ///< Callback for the error evaluator function.
+	const std::shared_ptr<PopulationInitializer<POP_TYPE,POP_DIM>>
+		population_initializer_; ///< Initial population generator, used instead of BaseDE::callback_population_generator_ when set.
 
 	//! BaseDE constructor
 	/*!
@@ -81,6 +150,28 @@ struct BaseDE {
 
 	}
 
+	//! BaseDE constructor
+	/*!
+		\param CR Mutation rate.
+		\param F Mutation weight.
+		\param population_initializer Generates the entire initial population
+			inside its bounds. See PopulationInitializer.
+		\param callback_calc_error Function used to calculate the error with a single
+			member of the population.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE.
+	*/
+	BaseDE(const double CR, const double F,
+		const PopulationInitializer<POP_TYPE,POP_DIM>& population_initializer,
+		const std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_error,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation) :
+			kCR_{CR}, kF_{F},
+			callback_calc_error_{callback_calc_error},
+			callback_error_evaluation_{callback_error_evaluation},
+			population_initializer_{std::make_shared<
+				PopulationInitializer<POP_TYPE,POP_DIM>>(population_initializer)} {
+
+	}
+
 	//! It solves one generation.
 	/*!
 		This is a blocking method.
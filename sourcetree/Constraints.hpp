@@ -0,0 +1,119 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#ifndef CONSTRAINTS_HPP_
+#define CONSTRAINTS_HPP_
+
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+namespace pdebc {
+
+//! Constraints checked before the error function.
+/*!
+	The violation callback returns how much an entity violates the
+	constraints (e.g. the sum of the violation of each one), 0 when it's
+	feasible. It should be much cheaper than the error function: the
+	engines call it first, and trials violating the constraints by more
+	than ConstraintHandler::epsilon() are compared by their violation only,
+	their error is never calculated.
+
+	Entities are compared with Deb's feasibility rules, relaxed by the
+	epsilon level of the epsilon-constrained method:
+	- entities violating by at most epsilon are feasible, and compared by
+		their error;
+	- a feasible entity beats an infeasible one;
+	- between infeasible entities, the lowest violation wins.
+
+	Epsilon starts at ConstraintHandler::kEpsilon0_ and decreases to 0 in
+	ConstraintHandler::kEpsilonGenerations_ generations, as
+	( kEpsilon0_ * (1 - g / kEpsilonGenerations_)^kEpsilonExponent_ ).
+	By default it's always 0 (pure Deb's rules).
+
+	Used by SequentialDE::setConstraints() and ThreadsDE::setConstraints().
+
+	\tparam POP_TYPE Population data type (usually 'double')
+	\tparam POP_DIM Population dimensions (usually 2D or 3D)
+*/
+template <class POP_TYPE, int POP_DIM>
+struct ConstraintHandler {
+
+	const std::function<double(const std::array<POP_TYPE,POP_DIM>&)>
+		callback_violation_; ///< Callback for the constraint violation function.
+	const double kEpsilon0_; ///< Initial epsilon level.
+	const uint32_t kEpsilonGenerations_; ///< Generations until epsilon is 0.
+	const double kEpsilonExponent_; ///< Decay speed of epsilon.
+
+	/*!
+		\param callback_violation Total violation of an entity, 0 if it's
+			feasible. It must never return a negative value.
+		\param epsilon0 Initial epsilon level. A good start is the violation
+			of the top 20% of the initial population.
+		\param epsilon_generations Generations until epsilon is 0.
+		\param epsilon_exponent Decay speed of epsilon, higher goes to 0 faster.
+	*/
+	ConstraintHandler(
+		const std::function<double(const std::array<POP_TYPE,POP_DIM>&)>& callback_violation,
+		const double epsilon0 = 0, const uint32_t epsilon_generations = 0,
+		const double epsilon_exponent = 5) :
+			callback_violation_{callback_violation},
+			kEpsilon0_{epsilon0}, kEpsilonGenerations_{epsilon_generations},
+			kEpsilonExponent_{epsilon_exponent} {
+
+	}
+
+	//! Epsilon level of generation `generation`.
+	/*!
+		It never increases, so an entity infeasible once stays infeasible
+		(its error is never needed).
+	*/
+	double epsilon(const uint64_t generation) const {
+		if (generation >= kEpsilonGenerations_) {
+			return 0;
+		}
+		return kEpsilon0_ * std::pow(1.0 - static_cast<double>(generation)
+			/ kEpsilonGenerations_, kEpsilonExponent_);
+	}
+
+	//! True if `a` (error `error_a`, violation `violation_a`) beats `b`.
+	/*!
+		The errors are only read when both entities are feasible at
+		`epsilon`.
+	*/
+	template <class ERROR_TYPE, class COMPARE>
+	static bool better(const ERROR_TYPE& error_a, const double violation_a,
+		const ERROR_TYPE& error_b, const double violation_b,
+		const double epsilon, const COMPARE& error_evaluation) {
+		const bool feasible_a = violation_a <= epsilon;
+		const bool feasible_b = violation_b <= epsilon;
+		if (feasible_a && feasible_b) {
+			return error_evaluation(error_a, error_b);
+		}
+		if (feasible_a != feasible_b) {
+			return feasible_a;
+		}
+		return violation_a < violation_b;
+	}
+};
+
+} // end namespace pdebc
+
+#endif /* CONSTRAINTS_HPP_ */
@@ -0,0 +1,101 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#ifndef CROSSOVER_HPP_
+#define CROSSOVER_HPP_
+
+#include <array>
+#include <cstdint>
+
+#include "BaseDE.hpp"
+
+/// \cond DEV
+namespace pdebc {
+
+//! Binomial crossover with a mask built from bulk random words.
+/*!
+	Each 64 bits random word decides two dimensions: a dimension takes the
+	mutant when its 32 bits half is below kThreshold_ (CR scaled to
+	2^32). The decisions are packed into a bit vector per 64 dimensions
+	first, then the trial is built with a select per dimension (no branch,
+	so compilers emit blend instructions), computing the mutant of every
+	dimension. Half an RNG call per dimension, and no unpredictable branch.
+
+	Every engine builds its trials with it. The engines sized at runtime
+	(DynamicDE, MappedDE) leave POP_DIM at 0 and use the pointer apply().
+
+	\tparam RNG of apply() must return 64 random bits per call (e.g.
+		SplitMix64 or std::mt19937_64).
+*/
+template <class POP_TYPE, int POP_DIM = 0>
+struct BinomialCrossover {
+
+	const uint64_t kThreshold_;
+
+	explicit BinomialCrossover(const double CR) :
+		kThreshold_{CR >= 1 ? (uint64_t{1} << 32)
+			: CR <= 0 ? 0 : static_cast<uint64_t>(CR * 4294967296.0)} {
+
+	}
+
+	//! trial = (mask ? a + F * (b - c) : target), the dimension j always mutated.
+	template <class RNG>
+	void apply(RNG& rng, const int j, const MutationType<POP_TYPE> F,
+		const std::array<POP_TYPE,POP_DIM>& a,
+		const std::array<POP_TYPE,POP_DIM>& b,
+		const std::array<POP_TYPE,POP_DIM>& c,
+		const std::array<POP_TYPE,POP_DIM>& target,
+		std::array<POP_TYPE,POP_DIM>& trial) const {
+		apply(rng, POP_DIM, j, F, a.data(), b.data(), c.data(),
+			target.data(), trial.data());
+	}
+
+	//! Same, over `n` dimensions. `trial` may be `target`. The entities
+	//! read may be stored in another type (MappedDE), the mutant is
+	//! computed in MutationType<POP_TYPE> anyway.
+	template <class RNG, class SRC_TYPE>
+	void apply(RNG& rng, const int n, const int j, const MutationType<POP_TYPE> F,
+		const SRC_TYPE* a, const SRC_TYPE* b, const SRC_TYPE* c,
+		const SRC_TYPE* target, POP_TYPE* trial) const {
+		typedef MutationType<POP_TYPE> M;
+		for (int d0 = 0; d0 < n; d0 += 64) {
+			const int m = n - d0 < 64 ? n - d0 : 64;
+			uint64_t mask = 0;
+			for (int d = 0; d < m; d += 2) {
+				const uint64_t r = rng();
+				mask |= static_cast<uint64_t>((r & 0xFFFFFFFFull) < kThreshold_) << d;
+				mask |= static_cast<uint64_t>((r >> 32) < kThreshold_) << (d + 1);
+			}
+			if (j >= d0 && j < d0 + m) {
+				mask |= uint64_t{1} << (j - d0);
+			}
+
+			for (int d = 0; d < m; ++d) {
+				const bool take = (mask >> d) & 1;
+				trial[d0 + d] = take ? static_cast<POP_TYPE>(static_cast<M>(a[d0 + d])
+					+ F * (static_cast<M>(b[d0 + d]) - c[d0 + d]))
+					: static_cast<POP_TYPE>(target[d0 + d]);
+			}
+		}
+	}
+};
+
+} // end namespace pdebc
+/// \endcond
+
+#endif /* CROSSOVER_HPP_ */
@@ -0,0 +1,242 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef DYNAMICDE_HPP_
+#define DYNAMICDE_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <tuple>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <stdexcept>
+
+#include "BaseDE.hpp"
+#include "Crossover.hpp"
+#include "Random.hpp"
+
+namespace pdebc {
+
+//! Differential Evolution with the dimension chosen at runtime.
+/*!
+	The population is kept in a single row major block
+	(DynamicDE::kPopSize_ x DynamicDE::kDim_), and the errors of an
+	entire generation are calculated by a single call to
+	DynamicDE::callback_calc_errors_.
+	This makes it a good fit for bindings (e.g. Python), where one call
+	per generation is much cheaper than one call per candidate.
+
+	Each generation builds every trial from the population of the previous
+	generation, then evaluates and selects them all at once.
+
+	\tparam POP_TYPE Population data type (usually 'double')
+	\tparam ERROR_TYPE Error type (usually 'double')
+*/
+template <class POP_TYPE, class ERROR_TYPE>
+struct DynamicDE {
+
+	const uint32_t kDim_; ///< Population dimensions.
+	const uint32_t kPopSize_; ///< Population size.
+	const double kCR_; ///< Mutation rate.
+	const double kF_; ///< Mutation weight.
+
+	const std::function<POP_TYPE()>
+		callback_population_generator_; ///< Callback for the population generator function.
+	const std::function<void(const POP_TYPE*,uint32_t,uint32_t,ERROR_TYPE*)>
+		callback_calc_errors_; ///< Callback for the batch error calculator function.
+	const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>
+		callback_error_evaluation_; ///< Callback for the error evaluator function.
+
+	std::vector<POP_TYPE> population_; ///< Entire population, row major.
+
+	/*!
+		\param dim Population dimensions.
+		\param POP_SIZE Population size. Must be at least 4
+			(std::invalid_argument otherwise).
+
+		\param CR Mutation rate. Determines the chances
+			of a mutation happening. This value must be
+			between [0,1].
+		\param F Mutation weight. Determines how much
+			the mutation impacts each trials. This value
+			should be between [0,1].
+		\param callback_population_generator Function used to generate each
+			entity of the population. It must return a POP_TYPE type and use no
+			parameters.
+		\param callback_calc_errors Function used to calculate the errors of
+			many members of the population at once. It takes a row major
+			(n x dim) block of candidates, 'n', 'dim' and an output array
+			of 'n' ERROR_TYPE.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE. It
+			must return a bool. In case of true, the population from the first ERROR_TYPE
+			will be picked as best candidate.
+	*/
+	DynamicDE(const uint32_t dim, const uint32_t POP_SIZE,
+		const double CR, const double F,
+		const std::function<POP_TYPE()>&& callback_population_generator,
+		const std::function<void(const POP_TYPE*,uint32_t,uint32_t,ERROR_TYPE*)>&& callback_calc_errors,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation) :
+			kDim_{dim}, kPopSize_{checkPopSize(POP_SIZE)}, kCR_{CR}, kF_{F},
+			callback_population_generator_{callback_population_generator},
+			callback_calc_errors_{callback_calc_errors},
+			callback_error_evaluation_{callback_error_evaluation} {
+
+		population_.resize(kPopSize_ * kDim_);
+		pop_errors_.resize(kPopSize_);
+		trials_.resize(kPopSize_ * kDim_);
+		trial_errors_.resize(kPopSize_);
+
+		using namespace std;
+		random_device rd;
+		emt_crossover_ = SplitMix64((static_cast<uint64_t>(rd()) << 32) | rd());
+
+		mt19937 emt2(rd());
+		uniform_int_distribution<uint32_t> ui2(0, kPopSize_-1);
+		random_trials_ = bind(ui2, emt2);
+
+		mt19937 emt3(rd());
+		uniform_int_distribution<uint32_t> ui3(0, kDim_-1);
+		random_j_ = bind(ui3, emt3);
+
+		generatePopulation();
+		calcGenerationError();
+	}
+
+	~DynamicDE() {
+
+	}
+
+	//! It solves one generation.
+	/*!
+		This is a blocking method.
+		DynamicDE::callback_calc_errors_ is called once.
+	*/
+	void solveOneGeneration() {
+		for (uint32_t i = 0; i < kPopSize_; ++i) {
+			mutation(i);
+		}
+		callback_calc_errors_(trials_.data(), kPopSize_, kDim_,
+			trial_errors_.data());
+		for (uint32_t i = 0; i < kPopSize_; ++i) {
+			select(i);
+		}
+	}
+
+	//! It solves `N` generations.
+	/*!
+		\param N Number of generations to solve.
+	*/
+	void solveNGenerations(const uint32_t N) {
+		for (uint32_t g = 0; g < N; ++g) {
+			solveOneGeneration();
+		}
+	}
+
+	//! It gets the best candidate.
+	/*!
+		This operation has an O(N) complexity, where N is the population size.
+	*/
+	std::tuple<ERROR_TYPE,std::vector<POP_TYPE>> getBestCandidate() const {
+		auto e = std::min_element(pop_errors_.begin(), pop_errors_.end(),
+			callback_error_evaluation_);
+		auto min = std::distance(pop_errors_.begin(), e);
+
+		std::vector<POP_TYPE> r(population_.begin() + min * kDim_,
+			population_.begin() + (min + 1) * kDim_);
+
+		return std::tuple<ERROR_TYPE,std::vector<POP_TYPE>>{pop_errors_[min],r};
+	}
+
+	//! Errors of the entire population, in the same order as DynamicDE::population_.
+	const std::vector<ERROR_TYPE>& getErrors() const {
+		return pop_errors_;
+	}
+
+private:
+	SplitMix64 emt_crossover_;
+	const BinomialCrossover<POP_TYPE> crossover_{kCR_};
+	std::function<uint32_t()> random_trials_;
+	std::function<uint32_t()> random_j_;
+
+	std::vector<ERROR_TYPE> pop_errors_;
+	std::vector<POP_TYPE> trials_; // Used in "mutation"
+	std::vector<ERROR_TYPE> trial_errors_;
+
+	// DE/rand/1 draws 3 distinct donors, plus the target
+	static uint32_t checkPopSize(const uint32_t pop_size) {
+		if (pop_size < 4) {
+			throw std::invalid_argument(
+				"DynamicDE: the population needs at least 4 entities");
+		}
+		return pop_size;
+	}
+
+	void generatePopulation() {
+		for (auto& p : population_) {
+			p = callback_population_generator_();
+		}
+	}
+
+	void calcGenerationError() {
+		callback_calc_errors_(population_.data(), kPopSize_, kDim_,
+			pop_errors_.data());
+	}
+
+	void mutation(const uint32_t actual_index) {
+		const uint32_t j = random_j_();
+
+		const uint32_t it0 = random_trials_();
+		uint32_t it1 = random_trials_();
+		while (it1 == it0) {
+			it1 = random_trials_();
+		}
+		uint32_t it2 = random_trials_();
+		while (it2 == it1 || it2 == it0) {
+			it2 = random_trials_();
+		}
+
+		const POP_TYPE* a = &population_[it0 * kDim_];
+		const POP_TYPE* b = &population_[it1 * kDim_];
+		const POP_TYPE* c = &population_[it2 * kDim_];
+		const POP_TYPE* x = &population_[actual_index * kDim_];
+		POP_TYPE* candidate = &trials_[actual_index * kDim_];
+
+		const MutationType<POP_TYPE> F = static_cast<MutationType<POP_TYPE>>(kF_);
+		crossover_.apply(emt_crossover_, kDim_, j, F, a, b, c, x, candidate);
+	}
+
+	void select(const uint32_t actual_index) {
+		if (callback_error_evaluation_(trial_errors_[actual_index],
+				pop_errors_[actual_index])) {
+			std::copy_n(&trials_[actual_index * kDim_], kDim_,
+				&population_[actual_index * kDim_]);
+			pop_errors_[actual_index] = trial_errors_[actual_index];
+		}
+	}
+};
+
+#ifdef PDEBC_EXTERN_TEMPLATES
+/// \cond DEV
+extern template struct DynamicDE<double,double>;
+extern template struct DynamicDE<float,float>;
+/// \endcond
+#endif
+
+} // end namespace pdebc
+
+#endif /* DYNAMICDE_HPP_ */
@@ -0,0 +1,357 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef LOCALSEARCH_HPP_
+#define LOCALSEARCH_HPP_
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <tuple>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cmath>
+#include <memory>
+#include <utility>
+
+#include "Constraints.hpp"
+#include "VariableTypes.hpp"
+
+namespace pdebc {
+
+//! Nelder-Mead simplex search, starting at `x0`.
+/*!
+	Only compares errors (with `error_evaluation`), so any ERROR_TYPE works.
+
+	\param calc_error Error function.
+	\param error_evaluation Error comparison, true if the first one is better.
+	\param x0 Starting point.
+	\param e0 Error of `x0`.
+	\param steps Size of the initial simplex in each dimension.
+	\param max_evaluations Evaluation budget.
+	\return Best error, best point and the number of evaluations used.
+*/
+template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
+std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>,uint32_t> nelderMead(
+	const std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>& calc_error,
+	const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>& error_evaluation,
+	const std::array<POP_TYPE,POP_DIM>& x0, const ERROR_TYPE& e0,
+	const std::array<double,POP_DIM>& steps, const uint32_t max_evaluations) {
+	using namespace std;
+	typedef array<POP_TYPE,POP_DIM> Point;
+	const int N = POP_DIM;
+
+	vector<Point> simplex(N + 1, x0);
+	vector<ERROR_TYPE> errors(N + 1, e0);
+	uint32_t evaluations = 0;
+	auto eval = [&](const Point& x) {
+		++evaluations;
+		return calc_error(x);
+	};
+	for (int d = 0; d < N; ++d) {
+		simplex[d + 1][d] = static_cast<POP_TYPE>(x0[d] + steps[d]);
+		errors[d + 1] = eval(simplex[d + 1]);
+	}
+
+	vector<int> order(N + 1);
+	// p = c + t * (w - c), the points along the worst-centroid line
+	auto along = [](const array<double,POP_DIM>& c, const Point& w, const double t) {
+		Point p;
+		for (int d = 0; d < POP_DIM; ++d) {
+			p[d] = static_cast<POP_TYPE>(c[d] + t * (w[d] - c[d]));
+		}
+		return p;
+	};
+
+	while (evaluations + 2 <= max_evaluations) {
+		for (int i = 0; i <= N; ++i) {
+			order[i] = i;
+		}
+		sort(order.begin(), order.end(), [&](const int a, const int b) {
+			return error_evaluation(errors[a], errors[b]);
+		});
+		const int best = order[0];
+		const int worst = order[N];
+		const int second = order[N - 1];
+
+		// Converged: the simplex collapsed or all vertices are equal
+		double size = 0;
+		for (int i = 0; i <= N; ++i) {
+			for (int d = 0; d < N; ++d) {
+				size = max(size, abs(static_cast<double>(simplex[i][d])
+					- simplex[best][d]) / (1 + abs(static_cast<double>(simplex[best][d]))));
+			}
+		}
+		if (size < 1e-15 || !error_evaluation(errors[best], errors[worst])) {
+			break;
+		}
+
+		array<double,POP_DIM> c;
+		c.fill(0);
+		for (int i = 0; i <= N; ++i) {
+			if (i != worst) {
+				for (int d = 0; d < N; ++d) {
+					c[d] += static_cast<double>(simplex[i][d]) / N;
+				}
+			}
+		}
+
+		const Point r = along(c, simplex[worst], -1.0);
+		const ERROR_TYPE er = eval(r);
+		if (error_evaluation(er, errors[best])) {
+			const Point e = along(c, simplex[worst], -2.0);
+			const ERROR_TYPE ee = eval(e);
+			if (error_evaluation(ee, er)) {
+				simplex[worst] = e;
+				errors[worst] = ee;
+			} else {
+				simplex[worst] = r;
+				errors[worst] = er;
+			}
+		} else if (error_evaluation(er, errors[second])) {
+			simplex[worst] = r;
+			errors[worst] = er;
+		} else {
+			// Outside or inside contraction
+			const bool outside = error_evaluation(er, errors[worst]);
+			const Point k = along(c, simplex[worst], outside ? -0.5 : 0.5);
+			const ERROR_TYPE ek = eval(k);
+			if (error_evaluation(ek, outside ? er : errors[worst])) {
+				simplex[worst] = k;
+				errors[worst] = ek;
+			} else {
+				// Shrink towards the best vertex
+				if (evaluations + N > max_evaluations) {
+					break;
+				}
+				for (int i = 0; i <= N; ++i) {
+					if (i != best) {
+						for (int d = 0; d < N; ++d) {
+							simplex[i][d] = static_cast<POP_TYPE>(simplex[best][d]
+								+ 0.5 * (simplex[i][d] - simplex[best][d]));
+						}
+						errors[i] = eval(simplex[i]);
+					}
+				}
+			}
+		}
+	}
+
+	int best = 0;
+	for (int i = 1; i <= N; ++i) {
+		if (error_evaluation(errors[i], errors[best])) {
+			best = i;
+		}
+	}
+	return make_tuple(errors[best], simplex[best], evaluations);
+}
+
+/// \cond DEV
+//! Runs nelderMead() on another thread, used by the engines' local search.
+/*!
+	The thread is started once, with the runner, and every search of the
+	engine runs on it.
+*/
+template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
+struct LocalSearchRunner {
+
+	typedef std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>,uint32_t> Result;
+
+	const uint32_t kPeriod_;
+	const uint32_t kMaxEvaluations_;
+
+	LocalSearchRunner(const uint32_t period, const uint32_t max_evaluations) :
+		kPeriod_{std::max<uint32_t>(1, period)},
+		kMaxEvaluations_{max_evaluations} {
+
+		worker_ = std::thread(&LocalSearchRunner::run, this);
+	}
+
+	//! Waits for the search running, if any.
+	~LocalSearchRunner() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			finish_ = true;
+		}
+		cond_.notify_one();
+		worker_.join();
+	}
+
+	LocalSearchRunner(const LocalSearchRunner&) = delete;
+	LocalSearchRunner& operator=(const LocalSearchRunner&) = delete;
+
+	//! Counts a generation, true when a search should start.
+	bool tick() {
+		return !running_ && ++generations_ >= kPeriod_;
+	}
+
+	//! With `constraints` the vertices are ranked by Deb's rules at the
+	//! `epsilon` level, and the error of an infeasible one is never
+	//! calculated. The result counts the error calls only. With
+	//! `variable_types` each vertex is repaired before it's checked, so
+	//! the simplex moves freely but only valid entities are evaluated.
+	void start(
+		const std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>& calc_error,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>& error_evaluation,
+		const std::array<POP_TYPE,POP_DIM>& x0, const ERROR_TYPE& e0,
+		const std::array<double,POP_DIM>& steps,
+		const std::shared_ptr<const ConstraintHandler<POP_TYPE,POP_DIM>>& constraints = nullptr,
+		const double epsilon = 0,
+		const std::shared_ptr<const VariableTypes<POP_DIM>>& variable_types = nullptr) {
+		generations_ = 0;
+		running_ = true;
+		const uint32_t max_evaluations = kMaxEvaluations_;
+		std::lock_guard<std::mutex> lock(mutex_);
+		job_ = [=]() {
+			using namespace std;
+			typedef array<POP_TYPE,POP_DIM> Point;
+			auto repaired = [&](const Point& x) {
+				Point y = x;
+				if (variable_types) {
+					variable_types->repair(y);
+				}
+				return y;
+			};
+			if (!constraints) {
+				function<ERROR_TYPE(const Point&)> repaired_error =
+					[&](const Point& x) {
+						return calc_error(repaired(x));
+					};
+				auto r = nelderMead<POP_TYPE,POP_DIM,ERROR_TYPE>(repaired_error,
+					error_evaluation, x0, e0, steps, max_evaluations);
+				get<1>(r) = repaired(get<1>(r));
+				return r;
+			}
+
+			typedef pair<ERROR_TYPE,double> Ranked; // Error and violation
+			uint32_t calls = 0;
+			function<Ranked(const Point&)> ranked_error =
+				[&](const Point& x) -> Ranked {
+					const Point y = repaired(x);
+					const double v = constraints->callback_violation_(y);
+					if (v > epsilon) {
+						return Ranked(e0, v); // The error isn't read
+					}
+					++calls;
+					return Ranked(calc_error(y), v);
+				};
+			function<bool(const Ranked&,const Ranked&)> ranked_evaluation =
+				[&](const Ranked& a, const Ranked& b) {
+					return ConstraintHandler<POP_TYPE,POP_DIM>::better(a.first,
+						a.second, b.first, b.second, epsilon, error_evaluation);
+				};
+			auto r = nelderMead<POP_TYPE,POP_DIM,Ranked>(ranked_error,
+				ranked_evaluation, x0,
+				Ranked(e0, constraints->callback_violation_(x0)),
+				steps, max_evaluations);
+			return make_tuple(get<0>(r).first, repaired(get<1>(r)), calls);
+		};
+		cond_.notify_one();
+	}
+
+	//! Takes the result of the search, if it's done.
+	/*!
+		Rethrows what the search threw, if it did.
+	*/
+	bool poll(Result& out) {
+		std::exception_ptr error;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!running_ || !done_) {
+				return false;
+			}
+			done_ = false;
+			out = result_;
+			std::swap(error, error_);
+		}
+		running_ = false;
+		if (error) {
+			std::rethrow_exception(error);
+		}
+		return true;
+	}
+
+	//! Steps of the initial simplex: half of the spread of `population`
+	//! in each dimension, so it shrinks as DE converges.
+	static std::array<double,POP_DIM> steps(
+		const std::vector<std::array<POP_TYPE,POP_DIM>>& population) {
+		std::array<double,POP_DIM> s;
+		for (int d = 0; d < POP_DIM; ++d) {
+			double lo = population[0][d];
+			double hi = lo;
+			for (auto& x : population) {
+				lo = std::min<double>(lo, x[d]);
+				hi = std::max<double>(hi, x[d]);
+			}
+			s[d] = 0.5 * (hi - lo);
+			if (s[d] == 0) {
+				s[d] = 1e-8 * std::max(1.0, std::abs(lo));
+			}
+		}
+		return s;
+	}
+
+private:
+	uint32_t generations_{0};
+	bool running_{false}; // From start() until poll() takes the result
+
+	std::thread worker_;
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	std::function<Result()> job_;
+	Result result_;
+	std::exception_ptr error_;
+	bool done_{false};
+	bool finish_{false};
+
+	void run() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		for (;;) {
+			cond_.wait(lock, [this]() {
+				return this->finish_ || this->job_;
+			});
+			if (finish_) {
+				return;
+			}
+			std::function<Result()> job;
+			job.swap(job_);
+			lock.unlock();
+
+			Result result;
+			std::exception_ptr error;
+			try {
+				result = job();
+			} catch (...) {
+				error = std::current_exception();
+			}
+
+			lock.lock();
+			result_ = result;
+			error_ = error;
+			done_ = true;
+		}
+	}
+};
+/// \endcond
+
+} // end namespace pdebc
+
+#endif /* LOCALSEARCH_HPP_ */
@@ -0,0 +1,319 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#ifndef MAPPEDDE_HPP_
+#define MAPPEDDE_HPP_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <tuple>
+#include <algorithm>
+#include <functional>
+#include <random>
+
+#include "BaseDE.hpp"
+#include "MappedFile.hpp"
+#include "Crossover.hpp"
+#include "Random.hpp"
+
+namespace pdebc {
+
+//! Differential Evolution for populations larger than the RAM.
+/*!
+	Like DynamicDE (runtime dimension, batch error callback), but the
+	population and its errors live in a MappedFile instead of vectors.
+
+	Each generation is a single sequential sweep over the file, in chunks of
+	MappedDE::kChunkSize_ entities: the trials of a chunk are built in RAM,
+	evaluated by a single call to MappedDE::callback_calc_errors_, and the
+	winners are written back in place. The next chunk is read ahead while
+	the current one is evaluated, and the chunks already done are dropped
+	from memory, so only a few chunks are resident at once, whatever the
+	population size.
+
+	To keep the accesses sequential, the donors of a trial are picked from
+	a window of MappedDE::kWindow_ entities starting at the first entity of
+	its chunk (wrapping around at the end), instead of the whole
+	population. The windows overlap, so good entities still spread over
+	the whole population. With a window as large as the population, it's
+	the plain DE.
+
+	Coordinates are stored as STORAGE_TYPE, e.g. `float` to halve the file
+	size. The trials are rounded to STORAGE_TYPE before being evaluated, so
+	the stored entities always match their errors.
+
+	\tparam POP_TYPE Population data type, used by the arithmetic and the
+		error callback (usually 'double')
+	\tparam ERROR_TYPE Error type (usually 'double')
+	\tparam STORAGE_TYPE Data type of the stored coordinates.
+*/
+template <class POP_TYPE, class ERROR_TYPE, class STORAGE_TYPE = POP_TYPE>
+struct MappedDE {
+
+	const uint32_t kDim_; ///< Population dimensions.
+	const uint64_t kPopSize_; ///< Population size.
+	const double kCR_; ///< Mutation rate.
+	const double kF_; ///< Mutation weight.
+	const uint32_t kChunkSize_; ///< Entities evaluated by each call of the error callback.
+	const uint32_t kWindow_; ///< Entities the donors are picked from.
+
+	const std::function<POP_TYPE()>
+		callback_population_generator_; ///< Callback for the population generator function.
+	const std::function<void(const POP_TYPE*,uint32_t,uint32_t,ERROR_TYPE*)>
+		callback_calc_errors_; ///< Callback for the batch error calculator function.
+	const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>
+		callback_error_evaluation_; ///< Callback for the error evaluator function.
+
+	/*!
+		\param path File holding the population and its errors. It's
+			created (or truncated). An empty path uses an anonymous
+			temporary file. See MappedFile.
+		\param dim Population dimensions.
+		\param POP_SIZE Population size. Must be at least 4.
+
+		\param CR Mutation rate. Determines the chances
+			of a mutation happening. This value must be
+			between [0,1].
+		\param F Mutation weight. Determines how much
+			the mutation impacts each trials. This value
+			should be between [0,1].
+		\param callback_population_generator Function used to generate each
+			entity of the population. It must return a POP_TYPE type and use no
+			parameters.
+		\param callback_calc_errors Function used to calculate the errors of
+			a chunk of candidates at once. It takes a row major (n x dim) block
+			of candidates, 'n', 'dim' and an output array of 'n' ERROR_TYPE.
+			It may evaluate them in parallel (see ProcessEvaluatorPool).
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE. It
+			must return a bool. In case of true, the population from the first ERROR_TYPE
+			will be picked as best candidate.
+		\param chunk_size Entities per chunk. Larger chunks mean larger
+			batches and longer read aheads, but more memory.
+		\param window Entities the donors are picked from, by default
+			two chunks. At least 4.
+	*/
+	MappedDE(const std::string& path, const uint32_t dim, const uint64_t POP_SIZE,
+		const double CR, const double F,
+		const std::function<POP_TYPE()>&& callback_population_generator,
+		const std::function<void(const POP_TYPE*,uint32_t,uint32_t,ERROR_TYPE*)>&& callback_calc_errors,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation,
+		const uint32_t chunk_size = 4096, const uint32_t window = 0) :
+			kDim_{dim}, kPopSize_{POP_SIZE}, kCR_{CR}, kF_{F},
+			kChunkSize_{static_cast<uint32_t>(std::max<uint64_t>(1,
+				std::min<uint64_t>(chunk_size, POP_SIZE)))},
+			kWindow_{static_cast<uint32_t>(std::min<uint64_t>(POP_SIZE,
+				std::max<uint64_t>(4, window == 0 ? 2ull * chunk_size : window)))},
+			callback_population_generator_{callback_population_generator},
+			callback_calc_errors_{callback_calc_errors},
+			callback_error_evaluation_{callback_error_evaluation},
+			file_(path, errorsOffset(dim, POP_SIZE) + POP_SIZE * sizeof(ERROR_TYPE)) {
+
+		population_ = reinterpret_cast<STORAGE_TYPE*>(file_.data());
+		pop_errors_ = reinterpret_cast<ERROR_TYPE*>(
+			file_.data() + errorsOffset(kDim_, kPopSize_));
+		trials_.resize(static_cast<std::size_t>(kChunkSize_) * kDim_);
+		trial_errors_.resize(kChunkSize_);
+
+		using namespace std;
+		random_device rd;
+		emt_crossover_ = SplitMix64((static_cast<uint64_t>(rd()) << 32) | rd());
+
+		emt_trials_.seed(rd());
+
+		mt19937 emt3(rd());
+		uniform_int_distribution<uint32_t> ui3(0, kDim_-1);
+		random_j_ = bind(ui3, emt3);
+
+		initialize();
+	}
+
+	~MappedDE() {
+
+	}
+
+	//! It solves one generation.
+	/*!
+		This is a blocking method, one sequential sweep over the file.
+		MappedDE::callback_calc_errors_ is called once per chunk.
+	*/
+	void solveOneGeneration() {
+		for (uint64_t first = 0; first < kPopSize_; first += kChunkSize_) {
+			const uint32_t n = static_cast<uint32_t>(
+				std::min<uint64_t>(kChunkSize_, kPopSize_ - first));
+			// The window of this chunk, read while it's being evaluated
+			prefetch(first + kChunkSize_, kWindow_);
+
+			for (uint32_t i = 0; i < n; ++i) {
+				mutation(first, first + i, &trials_[static_cast<std::size_t>(i) * kDim_]);
+			}
+			callback_calc_errors_(trials_.data(), n, kDim_, trial_errors_.data());
+			for (uint32_t i = 0; i < n; ++i) {
+				select(first + i, &trials_[static_cast<std::size_t>(i) * kDim_],
+					trial_errors_[i]);
+			}
+
+			release(first, n);
+		}
+	}
+
+	//! It solves `N` generations.
+	/*!
+		\param N Number of generations to solve.
+	*/
+	void solveNGenerations(const uint32_t N) {
+		for (uint32_t g = 0; g < N; ++g) {
+			solveOneGeneration();
+		}
+	}
+
+	//! It gets the best candidate.
+	/*!
+		This operation has an O(N) complexity, where N is the population
+		size. It sweeps the errors only.
+	*/
+	std::tuple<ERROR_TYPE,std::vector<POP_TYPE>> getBestCandidate() const {
+		uint64_t min = 0;
+		for (uint64_t i = 1; i < kPopSize_; ++i) {
+			if (callback_error_evaluation_(pop_errors_[i], pop_errors_[min])) {
+				min = i;
+			}
+		}
+		return std::tuple<ERROR_TYPE,std::vector<POP_TYPE>>{
+			pop_errors_[min], getEntity(min)};
+	}
+
+	//! Entity `i`, converted to POP_TYPE.
+	std::vector<POP_TYPE> getEntity(const uint64_t i) const {
+		const STORAGE_TYPE* x = population_ + i * kDim_;
+		return std::vector<POP_TYPE>(x, x + kDim_);
+	}
+
+	//! Error of entity `i`.
+	ERROR_TYPE getError(const uint64_t i) const {
+		return pop_errors_[i];
+	}
+
+	//! Writes the population and its errors to the file, blocking.
+	void flush() {
+		file_.flush();
+	}
+
+private:
+	SplitMix64 emt_crossover_;
+	const BinomialCrossover<POP_TYPE> crossover_{kCR_};
+	std::mt19937_64 emt_trials_;
+	std::function<uint32_t()> random_j_;
+
+	MappedFile file_;
+	STORAGE_TYPE* population_; // Row major, inside file_
+	ERROR_TYPE* pop_errors_; // Inside file_, after the population
+	std::vector<POP_TYPE> trials_; // One chunk, used in "mutation"
+	std::vector<ERROR_TYPE> trial_errors_;
+
+	// The errors start at a cache line boundary after the coordinates
+	static std::size_t errorsOffset(const uint32_t dim, const uint64_t pop_size) {
+		const std::size_t bytes = pop_size * dim * sizeof(STORAGE_TYPE);
+		return (bytes + 63) / 64 * 64;
+	}
+
+	void prefetch(const uint64_t first, const uint64_t n) {
+		// The window may wrap around to the start of the file
+		for (uint64_t b = first % kPopSize_, left = std::min(n, kPopSize_);
+			left > 0; b = 0) {
+			const uint64_t m = std::min(left, kPopSize_ - b);
+			file_.willNeed(b * kDim_ * sizeof(STORAGE_TYPE), m * kDim_ * sizeof(STORAGE_TYPE));
+			file_.willNeed(errorsOffset(kDim_, kPopSize_) + b * sizeof(ERROR_TYPE),
+				m * sizeof(ERROR_TYPE));
+			left -= m;
+		}
+	}
+
+	void release(const uint64_t first, const uint64_t n) {
+		file_.dontNeed(first * kDim_ * sizeof(STORAGE_TYPE), n * kDim_ * sizeof(STORAGE_TYPE));
+		file_.dontNeed(errorsOffset(kDim_, kPopSize_) + first * sizeof(ERROR_TYPE),
+			n * sizeof(ERROR_TYPE));
+	}
+
+	// Generated and evaluated chunk by chunk, like a generation
+	void initialize() {
+		for (uint64_t first = 0; first < kPopSize_; first += kChunkSize_) {
+			const uint32_t n = static_cast<uint32_t>(
+				std::min<uint64_t>(kChunkSize_, kPopSize_ - first));
+			STORAGE_TYPE* x = population_ + first * kDim_;
+			for (std::size_t k = 0; k < static_cast<std::size_t>(n) * kDim_; ++k) {
+				x[k] = static_cast<STORAGE_TYPE>(callback_population_generator_());
+				trials_[k] = static_cast<POP_TYPE>(x[k]);
+			}
+			callback_calc_errors_(trials_.data(), n, kDim_, pop_errors_ + first);
+			release(first, n);
+		}
+	}
+
+	uint64_t randomDonor(const uint64_t first) {
+		return (first + std::uniform_int_distribution<uint64_t>(
+			0, kWindow_-1)(emt_trials_)) % kPopSize_;
+	}
+
+	// Stored precision, so the error matches what is written back
+	static POP_TYPE round(const POP_TYPE v) {
+		return static_cast<POP_TYPE>(static_cast<STORAGE_TYPE>(v));
+	}
+
+	void mutation(const uint64_t first, const uint64_t actual_index,
+		POP_TYPE* candidate) {
+		const uint32_t j = random_j_();
+
+		const uint64_t it0 = randomDonor(first);
+		uint64_t it1 = randomDonor(first);
+		while (it1 == it0) {
+			it1 = randomDonor(first);
+		}
+		uint64_t it2 = randomDonor(first);
+		while (it2 == it1 || it2 == it0) {
+			it2 = randomDonor(first);
+		}
+
+		const STORAGE_TYPE* a = population_ + it0 * kDim_;
+		const STORAGE_TYPE* b = population_ + it1 * kDim_;
+		const STORAGE_TYPE* c = population_ + it2 * kDim_;
+		const STORAGE_TYPE* x = population_ + actual_index * kDim_;
+		const MutationType<POP_TYPE> F = static_cast<MutationType<POP_TYPE>>(kF_);
+
+		crossover_.apply(emt_crossover_, kDim_, j, F, a, b, c, x, candidate);
+		// The target's values are stored already, this only rounds the mutants
+		for (uint32_t d = 0; d < kDim_; ++d) {
+			candidate[d] = round(candidate[d]);
+		}
+	}
+
+	void select(const uint64_t actual_index, const POP_TYPE* candidate,
+		const ERROR_TYPE& error_new) {
+		if (callback_error_evaluation_(error_new, pop_errors_[actual_index])) {
+			STORAGE_TYPE* x = population_ + actual_index * kDim_;
+			for (uint32_t d = 0; d < kDim_; ++d) {
+				x[d] = static_cast<STORAGE_TYPE>(candidate[d]);
+			}
+			pop_errors_[actual_index] = error_new;
+		}
+	}
+};
+
+} // end namespace pdebc
+
+#endif /* MAPPEDDE_HPP_ */
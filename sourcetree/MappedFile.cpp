@@ -0,0 +1,107 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace pdebc {
+
+MappedFile::MappedFile(const std::string& path, const std::size_t size) :
+		fd_{-1}, data_{nullptr}, size_{size},
+		page_size_{static_cast<std::size_t>(sysconf(_SC_PAGESIZE))} {
+
+	if (path.empty()) {
+		const char* dir = std::getenv("TMPDIR");
+		std::string name = std::string(dir != nullptr && *dir ? dir : "/tmp")
+			+ "/pdebc-XXXXXX";
+		std::vector<char> buffer(name.begin(), name.end());
+		buffer.push_back('\0');
+		fd_ = mkostemp(buffer.data(), O_CLOEXEC);
+		if (fd_ >= 0) {
+			// Gone as soon as it's closed
+			unlink(buffer.data());
+		}
+	} else {
+		fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	}
+	if (fd_ < 0) {
+		throw MappedFileError(std::string("open: ") + std::strerror(errno));
+	}
+	if (ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+		const int e = errno;
+		close(fd_);
+		throw MappedFileError(std::string("ftruncate: ") + std::strerror(e));
+	}
+	if (size_ == 0) {
+		return;
+	}
+	void* p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+	if (p == MAP_FAILED) {
+		const int e = errno;
+		close(fd_);
+		throw MappedFileError(std::string("mmap: ") + std::strerror(e));
+	}
+	data_ = static_cast<char*>(p);
+	madvise(data_, size_, MADV_SEQUENTIAL);
+}
+
+MappedFile::~MappedFile() {
+	if (data_ != nullptr) {
+		munmap(data_, size_);
+	}
+	close(fd_);
+}
+
+void MappedFile::willNeed(const std::size_t offset, const std::size_t length) {
+	if (offset >= size_ || length == 0) {
+		return;
+	}
+	// madvise() wants page aligned addresses, the range grows outwards
+	const std::size_t begin = offset / page_size_ * page_size_;
+	const std::size_t end = std::min(size_, offset + length);
+	madvise(data_ + begin, end - begin, MADV_WILLNEED);
+}
+
+void MappedFile::dontNeed(const std::size_t offset, const std::size_t length) {
+	if (offset >= size_ || length == 0) {
+		return;
+	}
+	// Only whole pages, the neighbour ranges may still be in use
+	const std::size_t begin = (offset + page_size_ - 1) / page_size_ * page_size_;
+	const std::size_t end = std::min(size_, offset + length) / page_size_ * page_size_;
+	if (end > begin) {
+		madvise(data_ + begin, end - begin, MADV_DONTNEED);
+	}
+}
+
+void MappedFile::flush() {
+	if (data_ != nullptr && msync(data_, size_, MS_SYNC) != 0) {
+		throw MappedFileError(std::string("msync: ") + std::strerror(errno));
+	}
+}
+
+} // end namespace pdebc
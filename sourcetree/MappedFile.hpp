@@ -0,0 +1,93 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#ifndef MAPPEDFILE_HPP_
+#define MAPPEDFILE_HPP_
+
+#include <cstddef>
+#include <string>
+#include <stdexcept>
+
+namespace pdebc {
+
+//! A file mapped in memory, read and written in place.
+/*!
+	The kernel pages the contents in and out as needed, so the file may be
+	much larger than the RAM. MappedFile::willNeed() and
+	MappedFile::dontNeed() tell it which ranges come next and which ones
+	are done, so a sequential sweep keeps a small resident set and reads
+	ahead of the accesses. Errors are reported with MappedFileError.
+*/
+struct MappedFile {
+
+	/*!
+		\param path File to create (or truncate). An empty path creates an
+			anonymous temporary file in $TMPDIR (or /tmp), removed when
+			closed.
+		\param size Size of the file, in bytes. Its pages are only
+			allocated on disk when written.
+	*/
+	MappedFile(const std::string& path, const std::size_t size);
+
+	//! Unmaps and closes the file. Written data stays in the file.
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	//! Start of the mapping.
+	char* data() const {
+		return data_;
+	}
+
+	//! Size of the mapping, in bytes.
+	std::size_t size() const {
+		return size_;
+	}
+
+	//! Starts reading [offset, offset + length) in the background.
+	void willNeed(const std::size_t offset, const std::size_t length);
+
+	//! Drops the pages fully inside [offset, offset + length) from memory.
+	/*!
+		Written data is not lost, the next access reads it from the file
+		again (or from the page cache).
+	*/
+	void dontNeed(const std::size_t offset, const std::size_t length);
+
+	//! Writes every modified page to the file, blocking.
+	void flush();
+
+private:
+	int fd_;
+	char* data_;
+	std::size_t size_;
+	std::size_t page_size_;
+};
+
+//! Thrown when a file can't be created, resized or mapped.
+struct MappedFileError : public std::runtime_error {
+	explicit MappedFileError(const std::string& what) :
+		std::runtime_error(what) {
+
+	}
+};
+
+} // end namespace pdebc
+
+#endif /* MAPPEDFILE_HPP_ */
@@ -0,0 +1,334 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#ifndef MIXEDPRECISIONDE_HPP_
+#define MIXEDPRECISIONDE_HPP_
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <algorithm>
+#include <functional>
+#include <random>
+
+#include "BaseDE.hpp"
+#include "Crossover.hpp"
+
+namespace pdebc {
+
+//! Differential Evolution searching in float, refining in double.
+/*!
+	The early generations only need to find the right basin, which float
+	does just as well with half the memory traffic (and twice the SIMD
+	width in the mutation, see MutationType). The population is kept in
+	single precision until one of:
+	- MixedPrecisionDE::kFloatGenerations_ generations are done;
+	- the population has collapsed to a few float ulps in every
+		dimension, so float can't make progress anymore;
+	- MixedPrecisionDE::promote() is called.
+
+	Then it's promoted to double, each entity (but the best one) jittered
+	inside its float rounding interval so the refinement has differences
+	finer than a float ulp, evaluated again with
+	BaseDE::callback_calc_error_, and the remaining generations run in
+	double precision.
+
+	While in float, the errors are calculated by the float error callback
+	if one is given (e.g. a float SIMD implementation), otherwise each
+	entity is converted to double and given to BaseDE::callback_calc_error_.
+
+	The algorithm is the one of SequentialDE (in place replacement).
+
+	\tparam POP_DIM Population dimensions (usually 2D or 3D)
+	\tparam ERROR_TYPE Error type (usually 'double')
+*/
+template <int POP_DIM, class ERROR_TYPE>
+struct MixedPrecisionDE : public BaseDE<double, POP_DIM, ERROR_TYPE> {
+
+	const uint32_t kPopSize_; ///< Population size.
+	const uint32_t kFloatGenerations_; ///< Generations run in single precision, at most.
+	const std::function<ERROR_TYPE(const std::array<float,POP_DIM>&)>
+		callback_calc_error_float_; ///< Optional single precision error calculator.
+
+	/*!
+		\param POP_SIZE Population size. Must be at least 4.
+
+		\param CR Mutation rate. Determines the chances
+			of a mutation happening. This value must be
+			between [0,1].
+		\param F Mutation weight. Determines how much
+			the mutation impacts each trials. This value
+			should be between [0,1].
+		\param callback_population_generator Function used to generate each
+			entity of the population. It must return a double and use no
+			parameters.
+		\param callback_calc_error Function used to calculate the error with a single
+			member of the population, in double precision.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE. It
+			must return a bool. In case of true, the population from the first ERROR_TYPE
+			will be picked as best candidate.
+		\param float_generations Generations run in single precision, at most.
+		\param callback_calc_error_float Optional single precision version of
+			`callback_calc_error`, used before the promotion.
+	*/
+	MixedPrecisionDE(const uint32_t POP_SIZE, const double CR, const double F,
+		const std::function<double()>&& callback_population_generator,
+		const std::function<ERROR_TYPE(const std::array<double,POP_DIM>&)>&& callback_calc_error,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation,
+		const uint32_t float_generations,
+		const std::function<ERROR_TYPE(const std::array<float,POP_DIM>&)>& callback_calc_error_float = nullptr) :
+			BaseDE<double, POP_DIM, ERROR_TYPE>(
+				CR, F,
+				std::move(callback_population_generator),
+				std::move(callback_calc_error),
+				std::move(callback_error_evaluation)),
+			kPopSize_{POP_SIZE}, kFloatGenerations_{float_generations},
+			callback_calc_error_float_{callback_calc_error_float} {
+
+		initialize();
+	}
+
+	/*!
+		\param POP_SIZE Population size. Must be at least 4.
+		\param CR Mutation rate.
+		\param F Mutation weight.
+		\param population_initializer Generates the entire initial population
+			inside its bounds. See PopulationInitializer.
+		\param callback_calc_error Function used to calculate the error with a single
+			member of the population, in double precision.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE.
+		\param float_generations Generations run in single precision, at most.
+		\param callback_calc_error_float Optional single precision version of
+			`callback_calc_error`, used before the promotion.
+	*/
+	MixedPrecisionDE(const uint32_t POP_SIZE, const double CR, const double F,
+		const PopulationInitializer<double,POP_DIM>& population_initializer,
+		const std::function<ERROR_TYPE(const std::array<double,POP_DIM>&)>&& callback_calc_error,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation,
+		const uint32_t float_generations,
+		const std::function<ERROR_TYPE(const std::array<float,POP_DIM>&)>& callback_calc_error_float = nullptr) :
+			BaseDE<double, POP_DIM, ERROR_TYPE>(
+				CR, F,
+				population_initializer,
+				std::move(callback_calc_error),
+				std::move(callback_error_evaluation)),
+			kPopSize_{POP_SIZE}, kFloatGenerations_{float_generations},
+			callback_calc_error_float_{callback_calc_error_float} {
+
+		initialize();
+	}
+
+	~MixedPrecisionDE() {
+
+	}
+
+	void solveOneGeneration() {
+		if (promoted_) {
+			evolve(population_, [this](const std::array<double,POP_DIM>& x) {
+				return this->callback_calc_error_(x);
+			});
+			return;
+		}
+		evolve(population_float_, [this](const std::array<float,POP_DIM>& x) {
+			return this->calcErrorFloat(x);
+		});
+		++float_generation_;
+		if (float_generation_ >= kFloatGenerations_ || collapsed()) {
+			promote();
+		}
+	}
+
+	void solveNGenerations(const uint32_t N) {
+		for (uint32_t g = 0; g < N; ++g) {
+			solveOneGeneration();
+		}
+	}
+
+	/*!
+		This operation has an O(N) complexity, where N is the population size.
+	*/
+	std::tuple<ERROR_TYPE,std::array<double,POP_DIM>> getBestCandidate() {
+		auto e = std::min_element(pop_errors_.begin(), pop_errors_.end(),
+			this->callback_error_evaluation_);
+		auto min = std::distance(pop_errors_.begin(), e);
+
+		std::array<double,POP_DIM> r;
+		if (promoted_) {
+			r = population_[min];
+		} else {
+			std::copy(population_float_[min].begin(), population_float_[min].end(),
+				r.begin());
+		}
+		return std::tuple<ERROR_TYPE,std::array<double,POP_DIM>>{pop_errors_[min],r};
+	}
+
+	//! Switches to double precision now.
+	/*!
+		The population is converted and evaluated again in double
+		precision. Does nothing if it's already in double.
+	*/
+	void promote() {
+		if (promoted_) {
+			return;
+		}
+		// The float population lies on a grid of float ulps, too coarse
+		// for the differences of the refinement. Every entity but the best
+		// one moves to a random point of its rounding interval.
+		const uint32_t best = std::distance(pop_errors_.begin(),
+			std::min_element(pop_errors_.begin(), pop_errors_.end(),
+				this->callback_error_evaluation_));
+		std::uniform_real_distribution<double> ud(-0.5, 0.5);
+		population_.resize(kPopSize_);
+		for (uint32_t i = 0; i < kPopSize_; ++i) {
+			for (int d = 0; d < POP_DIM; ++d) {
+				const float x = population_float_[i][d];
+				const double ulp = std::nextafter(std::fabs(x),
+					std::numeric_limits<float>::infinity()) - std::fabs(x);
+				population_[i][d] = x + (i == best ? 0 : ud(emt_) * ulp);
+			}
+			pop_errors_[i] = this->callback_calc_error_(population_[i]);
+		}
+		evaluations_ += kPopSize_;
+		population_float_.clear();
+		population_float_.shrink_to_fit();
+		promoted_ = true;
+	}
+
+	//! True once the population is in double precision.
+	bool isPromoted() const {
+		return promoted_;
+	}
+
+	//! Number of evaluations done so far, in both precisions.
+	uint64_t getEvaluations() const {
+		return evaluations_;
+	}
+
+private:
+	std::mt19937_64 emt_; // 64 bits, see BinomialCrossover
+
+	std::vector<std::array<float,POP_DIM>> population_float_;
+	std::vector<std::array<double,POP_DIM>> population_;
+	std::vector<ERROR_TYPE> pop_errors_;
+	bool promoted_{false};
+	uint32_t float_generation_{0};
+	uint64_t evaluations_{0};
+
+	// Spread of the population, in float ulps, below which
+	// float can't find better entities
+	static constexpr float kCollapseUlps_ = 16;
+
+	ERROR_TYPE calcErrorFloat(const std::array<float,POP_DIM>& x) const {
+		if (callback_calc_error_float_) {
+			return callback_calc_error_float_(x);
+		}
+		std::array<double,POP_DIM> d;
+		std::copy(x.begin(), x.end(), d.begin());
+		return this->callback_calc_error_(d);
+	}
+
+	void initialize() {
+		emt_.seed(std::random_device{}());
+
+		// Always generated in double, then rounded
+		std::vector<std::array<double,POP_DIM>> population(kPopSize_);
+		if (this->population_initializer_) {
+			this->population_initializer_->generate(population);
+		} else {
+			for (auto& x : population) {
+				for (int d = 0; d < POP_DIM; ++d) {
+					x[d] = this->callback_population_generator_();
+				}
+			}
+		}
+		population_float_.resize(kPopSize_);
+		pop_errors_.resize(kPopSize_);
+		for (uint32_t i = 0; i < kPopSize_; ++i) {
+			for (int d = 0; d < POP_DIM; ++d) {
+				population_float_[i][d] = static_cast<float>(population[i][d]);
+			}
+			pop_errors_[i] = calcErrorFloat(population_float_[i]);
+		}
+		evaluations_ = kPopSize_;
+		if (kFloatGenerations_ == 0) {
+			promote();
+		}
+	}
+
+	bool collapsed() const {
+		for (int d = 0; d < POP_DIM; ++d) {
+			float lo = population_float_[0][d];
+			float hi = lo;
+			for (auto& x : population_float_) {
+				lo = std::min(lo, x[d]);
+				hi = std::max(hi, x[d]);
+			}
+			const float scale = std::max(std::fabs(lo), std::fabs(hi));
+			if (hi - lo > kCollapseUlps_ * std::numeric_limits<float>::epsilon() * scale) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// SequentialDE's DE/rand/1/bin, in the precision of T
+	template <class T, class CALC>
+	void evolve(std::vector<std::array<T,POP_DIM>>& population, const CALC& calc_error) {
+		const BinomialCrossover<T,POP_DIM> crossover(this->kCR_);
+		std::uniform_int_distribution<uint32_t> ui(0, kPopSize_-1);
+		std::uniform_int_distribution<int> uj(0, POP_DIM-1);
+		const MutationType<T> F = static_cast<MutationType<T>>(this->kF_);
+		std::array<T,POP_DIM> candidate;
+
+		for (uint32_t i = 0; i < kPopSize_; ++i) {
+			const int j = uj(emt_);
+
+			const uint32_t it0 = ui(emt_);
+			uint32_t it1 = ui(emt_);
+			while (it1 == it0) {
+				it1 = ui(emt_);
+			}
+			uint32_t it2 = ui(emt_);
+			while (it2 == it1 || it2 == it0) {
+				it2 = ui(emt_);
+			}
+			const auto& a = population[it0];
+			const auto& b = population[it1];
+			const auto& c = population[it2];
+
+			crossover.apply(emt_, j, F, a, b, c, population[i], candidate);
+
+			const ERROR_TYPE error_new = calc_error(candidate);
+			++evaluations_;
+			if (this->callback_error_evaluation_(error_new, pop_errors_[i])) {
+				population[i] = candidate;
+				pop_errors_[i] = error_new;
+			}
+		}
+	}
+};
+
+template <int POP_DIM, class ERROR_TYPE>
+constexpr float MixedPrecisionDE<POP_DIM,ERROR_TYPE>::kCollapseUlps_;
+
+} // end namespace pdebc
+
+#endif /* MIXEDPRECISIONDE_HPP_ */
@@ -0,0 +1,494 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#ifndef MULTIOBJECTIVEDE_HPP_
+#define MULTIOBJECTIVEDE_HPP_
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <tuple>
+#include <limits>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <stdexcept>
+
+#include "BaseDE.hpp"
+#include "Crossover.hpp"
+#include "PopulationReduction.hpp"
+#include "Random.hpp"
+#include "ThreadPool.hpp"
+
+namespace pdebc {
+
+//! True if `a` Pareto dominates `b` (every objective minimized).
+/*!
+	`a` is no worse than `b` in every objective, and better in at least one.
+*/
+template <int N_OBJECTIVES>
+bool dominates(const std::array<double,N_OBJECTIVES>& a,
+	const std::array<double,N_OBJECTIVES>& b) {
+	bool better = false;
+	for (int m = 0; m < N_OBJECTIVES; ++m) {
+		if (b[m] < a[m]) {
+			return false;
+		}
+		better = better || a[m] < b[m];
+	}
+	return better;
+}
+
+//! Splits `objectives` in non-dominated fronts.
+/*!
+	Efficient non-dominated sort with binary search (ENS-BS): the entities
+	are sorted lexicographically, so one can only be dominated by the ones
+	before it, then each one goes to the first front without an entity
+	dominating it, found by a binary search over the fronts. It takes
+	O(M N log N) comparisons for M objectives on most populations, instead
+	of the O(M N^2) of the classic fast non-dominated sort.
+
+	\return Indexes of the entities of each front, the first front is the
+		Pareto front of `objectives`.
+*/
+template <int N_OBJECTIVES>
+std::vector<std::vector<uint32_t>> nonDominatedSort(
+	const std::vector<std::array<double,N_OBJECTIVES>>& objectives) {
+	using namespace std;
+	vector<uint32_t> order(objectives.size());
+	for (uint32_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	stable_sort(order.begin(), order.end(),
+		[&](const uint32_t a, const uint32_t b) {
+			return objectives[a] < objectives[b];
+		});
+
+	vector<vector<uint32_t>> fronts;
+	// The last entities of a front are the most likely to dominate
+	auto dominated = [&](const uint32_t s, const vector<uint32_t>& front) {
+		for (auto it = front.rbegin(); it != front.rend(); ++it) {
+			if (dominates<N_OBJECTIVES>(objectives[*it], objectives[s])) {
+				return true;
+			}
+		}
+		return false;
+	};
+	for (auto s : order) {
+		uint32_t lo = 0;
+		uint32_t hi = fronts.size();
+		while (lo < hi) {
+			const uint32_t mid = (lo + hi) / 2;
+			if (dominated(s, fronts[mid])) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		if (lo == fronts.size()) {
+			fronts.push_back(vector<uint32_t>());
+		}
+		fronts[lo].push_back(s);
+	}
+	return fronts;
+}
+
+//! Crowding distance of each entity of `front` (same order).
+/*!
+	Sum over the objectives of the normalized distance between the two
+	neighbours of the entity. The extremes of each objective get an
+	infinite distance, so they are never pruned.
+*/
+template <int N_OBJECTIVES>
+std::vector<double> crowdingDistance(
+	const std::vector<std::array<double,N_OBJECTIVES>>& objectives,
+	const std::vector<uint32_t>& front) {
+	using namespace std;
+	const uint32_t N = front.size();
+	vector<double> distance(N, 0);
+	if (N <= 2) {
+		distance.assign(N, numeric_limits<double>::infinity());
+		return distance;
+	}
+	vector<uint32_t> order(N);
+	for (int m = 0; m < N_OBJECTIVES; ++m) {
+		for (uint32_t i = 0; i < N; ++i) {
+			order[i] = i;
+		}
+		sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) {
+			return objectives[front[a]][m] < objectives[front[b]][m];
+		});
+		const double lo = objectives[front[order[0]]][m];
+		const double hi = objectives[front[order[N - 1]]][m];
+		distance[order[0]] = numeric_limits<double>::infinity();
+		distance[order[N - 1]] = numeric_limits<double>::infinity();
+		if (hi <= lo) {
+			continue;
+		}
+		for (uint32_t i = 1; i + 1 < N; ++i) {
+			distance[order[i]] += (objectives[front[order[i + 1]]][m]
+				- objectives[front[order[i - 1]]][m]) / (hi - lo);
+		}
+	}
+	return distance;
+}
+
+//! Multi-objective Differential Evolution (GDE3), over islands.
+/*!
+	Every entity has a vector of objectives, all minimized, instead of a
+	single error. The variation operators are the same DE/rand/1/bin ones.
+	The selection is the one of GDE3:
+	- if the trial weakly dominates its target, it replaces the target;
+	- if the target dominates the trial, the trial is dropped;
+	- otherwise both are kept, and once every trial is done the population
+		is pruned back to its size: the best non-dominated fronts are kept
+		(see nonDominatedSort()), and the last one that fits is trimmed by
+		removing its most crowded entity, one at a time (see
+		crowdingDistance()).
+
+	The population is split in islands, evolved in parallel by a ThreadPool.
+	After each generation, each island sends a random entity of its Pareto
+	front to the next island (with a MultiObjectiveDE::kMigrationPhi_
+	chance), where it competes in the pruning. A single run gives the whole
+	Pareto front (getParetoFront()), instead of one scalarized run for each
+	trade-off.
+
+	The random numbers of each island come from its own stream, picked by
+	(seed, generation, island), so for a fixed seed the results are the
+	same for any number of threads.
+
+	\tparam POP_TYPE Population data type (usually 'double')
+	\tparam POP_DIM Population dimensions (usually 2D or 3D)
+	\tparam N_OBJECTIVES Number of objectives.
+*/
+template <class POP_TYPE, int POP_DIM, int N_OBJECTIVES>
+struct MultiObjectiveDE {
+
+	typedef std::array<double,N_OBJECTIVES> Objectives; ///< Objectives of an entity.
+
+	const uint32_t kNThreads_; ///< Number of threads, the caller included.
+	const uint32_t kNIslands_; ///< Number of islands.
+	const double kMigrationPhi_; ///< Migration chance of each island.
+	const uint32_t kPopSize_; ///< Population size, of every island together.
+	const double kCR_; ///< Mutation rate.
+	const double kF_; ///< Mutation weight.
+	const uint64_t kSeed_; ///< Seed of every random stream.
+
+	const std::function<POP_TYPE()>
+		callback_population_generator_; ///< Callback for the population generator function.
+	const std::function<Objectives(const std::array<POP_TYPE,POP_DIM>&)>
+		callback_calc_objectives_; ///< Callback for the objectives calculator function.
+	const std::shared_ptr<PopulationInitializer<POP_TYPE,POP_DIM>>
+		population_initializer_; ///< Initial population sampling plan, if any.
+
+	/*!
+		\param n_threads Number of threads evolving the islands.
+		\param n_islands Number of islands, usually a few per thread. Each
+			island needs at least 4 entities, so `POP_SIZE / n_islands`
+			must be at least 4 (std::invalid_argument otherwise).
+		\param migration_phi Migration chance of each island, between [0,1].
+		\param POP_SIZE Population size, of every island together.
+		\param CR Mutation rate. Determines the chances
+			of a mutation happening. This value must be
+			between [0,1].
+		\param F Mutation weight. Determines how much
+			the mutation impacts each trials. This value
+			should be between [0,1].
+		\param callback_population_generator Function used to generate each
+			entity of the population. It is called by a single thread, in order.
+		\param callback_calc_objectives Function used to calculate the
+			objectives of a single member of the population. Every objective
+			is minimized. It must be thread safe.
+		\param seed Seed of the random streams.
+	*/
+	MultiObjectiveDE(const uint32_t n_threads, const uint32_t n_islands,
+		const double migration_phi, const uint32_t POP_SIZE,
+		const double CR, const double F,
+		const std::function<POP_TYPE()>&& callback_population_generator,
+		const std::function<Objectives(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_objectives,
+		const uint64_t seed = std::random_device{}()) :
+			kNThreads_{n_threads}, kNIslands_{checkIslands(n_islands, POP_SIZE)},
+			kMigrationPhi_{migration_phi}, kPopSize_{POP_SIZE},
+			kCR_{CR}, kF_{F}, kSeed_{seed},
+			callback_population_generator_{callback_population_generator},
+			callback_calc_objectives_{callback_calc_objectives},
+			pool_(n_threads) {
+
+		initialize();
+	}
+
+	/*!
+		\param n_threads Number of threads evolving the islands.
+		\param n_islands Number of islands, `POP_SIZE / n_islands` must be
+			at least 4 (std::invalid_argument otherwise).
+		\param migration_phi Migration chance of each island.
+		\param POP_SIZE Population size, of every island together.
+		\param CR Mutation rate.
+		\param F Mutation weight.
+		\param population_initializer Generates the entire initial population
+			inside its bounds, then each island gets a slice of it. It is
+			reseeded with `seed`. Opposition is not used here.
+			See PopulationInitializer.
+		\param callback_calc_objectives Function used to calculate the
+			objectives of a single member of the population. It must be
+			thread safe.
+		\param seed Seed of the random streams.
+	*/
+	MultiObjectiveDE(const uint32_t n_threads, const uint32_t n_islands,
+		const double migration_phi, const uint32_t POP_SIZE,
+		const double CR, const double F,
+		const PopulationInitializer<POP_TYPE,POP_DIM>& population_initializer,
+		const std::function<Objectives(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_objectives,
+		const uint64_t seed = std::random_device{}()) :
+			kNThreads_{n_threads}, kNIslands_{checkIslands(n_islands, POP_SIZE)},
+			kMigrationPhi_{migration_phi}, kPopSize_{POP_SIZE},
+			kCR_{CR}, kF_{F}, kSeed_{seed},
+			callback_calc_objectives_{callback_calc_objectives},
+			population_initializer_{std::make_shared<PopulationInitializer<POP_TYPE,POP_DIM>>(
+				population_initializer)},
+			pool_(n_threads) {
+
+		initialize();
+	}
+
+	~MultiObjectiveDE() {
+
+	}
+
+	//! It solves one generation.
+	/*!
+		This is a blocking method.
+	*/
+	void solveOneGeneration() {
+		pool_.parallelFor(kNIslands_, 1,
+			[this](const uint32_t begin, const uint32_t end) {
+				for (uint32_t k = begin; k < end; ++k) {
+					this->evolve(k);
+				}
+			});
+		migration();
+		++generation_;
+	}
+
+	void solveNGenerations(const uint32_t N) {
+		for (uint32_t g = 0; g < N; ++g) {
+			solveOneGeneration();
+		}
+	}
+
+	//! Non-dominated entities of every island together.
+	/*!
+		This operation has an O(M N log N) complexity, where N is the
+		population size and M the number of objectives.
+	*/
+	std::vector<std::tuple<Objectives,std::array<POP_TYPE,POP_DIM>>> getParetoFront() const {
+		using namespace std;
+		vector<Objectives> objectives;
+		vector<array<POP_TYPE,POP_DIM>> population;
+		for (auto& island : islands_) {
+			objectives.insert(objectives.end(), island.objectives.begin(),
+				island.objectives.end());
+			population.insert(population.end(), island.population.begin(),
+				island.population.end());
+		}
+		vector<tuple<Objectives,array<POP_TYPE,POP_DIM>>> front;
+		const auto fronts = nonDominatedSort<N_OBJECTIVES>(objectives);
+		for (auto i : fronts[0]) {
+			front.push_back(make_tuple(objectives[i], population[i]));
+		}
+		return front;
+	}
+
+	//! Number of evaluations done so far, the initial population included.
+	uint64_t getEvaluations() const {
+		uint64_t n = 0;
+		for (auto& island : islands_) {
+			n += island.evaluations;
+		}
+		return n;
+	}
+
+	//! Number of generations solved so far.
+	uint64_t getGeneration() const {
+		return generation_;
+	}
+
+private:
+	struct Island {
+		uint32_t size; // Kept after each pruning
+		std::vector<std::array<POP_TYPE,POP_DIM>> population;
+		std::vector<Objectives> objectives;
+		uint64_t evaluations;
+	};
+
+	ThreadPool pool_;
+	std::vector<Island> islands_;
+	uint64_t generation_{0};
+	const BinomialCrossover<POP_TYPE,POP_DIM> crossover_{kCR_};
+
+	// DE/rand/1 draws 3 distinct donors, plus the target, from each island
+	static uint32_t checkIslands(const uint32_t n_islands, const uint32_t pop_size) {
+		const uint32_t islands = std::max<uint32_t>(1, n_islands);
+		if (pop_size / islands < 4) {
+			throw std::invalid_argument(
+				"MultiObjectiveDE: every island needs at least 4 entities");
+		}
+		return islands;
+	}
+
+	void initialize() {
+		using namespace std;
+		vector<array<POP_TYPE,POP_DIM>> population(kPopSize_);
+		if (population_initializer_) {
+			population_initializer_->seed(
+				static_cast<mt19937::result_type>(SplitMix64::mix(kSeed_)));
+			population_initializer_->generate(population);
+		} else {
+			for (auto& x : population) {
+				for (int d = 0; d < POP_DIM; ++d) {
+					x[d] = callback_population_generator_();
+				}
+			}
+		}
+
+		islands_.resize(kNIslands_);
+		uint32_t first = 0;
+		for (uint32_t k = 0; k < kNIslands_; ++k) {
+			Island& island = islands_[k];
+			island.size = kPopSize_ / kNIslands_
+				+ (k < kPopSize_ % kNIslands_ ? 1 : 0);
+			island.population.assign(population.begin() + first,
+				population.begin() + first + island.size);
+			island.objectives.resize(island.size);
+			island.evaluations = island.size;
+			first += island.size;
+		}
+
+		pool_.parallelFor(kNIslands_, 1,
+			[this](const uint32_t begin, const uint32_t end) {
+				for (uint32_t k = begin; k < end; ++k) {
+					Island& island = this->islands_[k];
+					for (uint32_t i = 0; i < island.size; ++i) {
+						island.objectives[i] =
+							this->callback_calc_objectives_(island.population[i]);
+					}
+				}
+			});
+	}
+
+	// DE/rand/1/bin over the island, then the GDE3 selection.
+	// Only touches island `k`.
+	void evolve(const uint32_t k) {
+		Island& island = islands_[k];
+		SplitMix64 rng = SplitMix64::stream(kSeed_, generation_, k);
+		const uint32_t N = island.size;
+		const MutationType<POP_TYPE> F = static_cast<MutationType<POP_TYPE>>(kF_);
+
+		for (uint32_t i = 0; i < N; ++i) {
+			const int j = rng.nextIndex(POP_DIM);
+
+			const uint32_t it0 = rng.nextIndex(N);
+			uint32_t it1 = rng.nextIndex(N);
+			while (it1 == it0) {
+				it1 = rng.nextIndex(N);
+			}
+			uint32_t it2 = rng.nextIndex(N);
+			while (it2 == it1 || it2 == it0) {
+				it2 = rng.nextIndex(N);
+			}
+
+			const auto& a = island.population[it0];
+			const auto& b = island.population[it1];
+			const auto& c = island.population[it2];
+			std::array<POP_TYPE,POP_DIM> candidate = island.population[i];
+
+			crossover_.apply(rng, j, F, a, b, c, candidate, candidate);
+
+			const Objectives objectives = callback_calc_objectives_(candidate);
+			++island.evaluations;
+			if (!dominates<N_OBJECTIVES>(objectives, island.objectives[i])
+				&& island.objectives[i] != objectives) {
+				if (dominates<N_OBJECTIVES>(island.objectives[i], objectives)) {
+					continue;
+				}
+				// Neither is better, both stay until the pruning
+				island.population.push_back(candidate);
+				island.objectives.push_back(objectives);
+				continue;
+			}
+			island.population[i] = candidate;
+			island.objectives[i] = objectives;
+		}
+		prune(island);
+	}
+
+	// Keeps the best island.size entities: whole fronts while they fit,
+	// then the least crowded of the next one
+	static void prune(Island& island) {
+		using namespace std;
+		if (island.population.size() <= island.size) {
+			return;
+		}
+		vector<uint32_t> keep;
+		for (auto& front : nonDominatedSort<N_OBJECTIVES>(island.objectives)) {
+			if (keep.size() + front.size() <= island.size) {
+				keep.insert(keep.end(), front.begin(), front.end());
+				continue;
+			}
+			vector<uint32_t> last = front;
+			while (keep.size() + last.size() > island.size) {
+				const auto distance = crowdingDistance<N_OBJECTIVES>(
+					island.objectives, last);
+				const uint32_t worst = std::distance(distance.begin(),
+					min_element(distance.begin(), distance.end()));
+				last.erase(last.begin() + worst);
+			}
+			keep.insert(keep.end(), last.begin(), last.end());
+			break;
+		}
+		sort(keep.begin(), keep.end());
+		compactTo(island.population, keep);
+		compactTo(island.objectives, keep);
+	}
+
+	// Ring topology: a random entity of the Pareto front of each island
+	// joins the next island
+	void migration() {
+		SplitMix64 rng = SplitMix64::stream(kSeed_, generation_, kNIslands_);
+		if (kNIslands_ < 2) {
+			return;
+		}
+		for (uint32_t k = 0; k < kNIslands_; ++k) {
+			if (rng.nextDouble() >= kMigrationPhi_) {
+				continue;
+			}
+			const Island& source = islands_[k];
+			const auto front = nonDominatedSort<N_OBJECTIVES>(source.objectives)[0];
+			const uint32_t m = front[rng.nextIndex(front.size())];
+			Island& target = islands_[(k + 1) % kNIslands_];
+			target.population.push_back(source.population[m]);
+			target.objectives.push_back(source.objectives[m]);
+			prune(target);
+		}
+	}
+};
+
+} // end namespace pdebc
+
+#endif /* MULTIOBJECTIVEDE_HPP_ */
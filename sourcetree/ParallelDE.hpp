@@ -0,0 +1,283 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef PARALLELDE_HPP_
+#define PARALLELDE_HPP_
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <tuple>
+#include <algorithm>
+#include <functional>
+#include <random>
+
+#include "BaseDE.hpp"
+#include "Crossover.hpp"
+#include "Random.hpp"
+#include "ThreadPool.hpp"
+
+namespace pdebc {
+
+//! Single population Differential Evolution, evaluated by many threads.
+/*!
+	Unlike ThreadsDE, there are no islands: it is the plain DE algorithm
+	over the entire population, only faster.
+
+	The population is double buffered. Every trial of generation `g` is
+	built from the population of generation `g-1`, which is read only
+	during the generation, then the errors and the selection are computed
+	in parallel over chunks of entities. The random numbers of each entity
+	come from its own stream, picked by (seed, generation, entity), so for
+	a fixed seed the results are the same for any number of threads.
+
+	Note this is the synchronous (generational) DE, as in DynamicDE.
+	SequentialDE replaces each entity as soon as its trial wins, so the
+	next trials of the same generation may already use it.
+
+	BaseDE::callback_calc_error_ is called by many threads at once, so it
+	must be thread safe.
+
+	\tparam POP_TYPE Population data type (usually 'double')
+	\tparam POP_DIM Population dimensions (usually 2D or 3D)
+	\tparam ERROR_TYPE Error type (usually 'double')
+*/
+template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
+struct ParallelDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
+
+	const uint32_t kNThreads_; ///< Number of threads, the caller included.
+	const uint32_t kPopSize_; ///< Population size.
+	const uint64_t kSeed_; ///< Seed of every random stream.
+	std::vector<std::array<POP_TYPE,POP_DIM>> population_; ///< Entire population.
+
+	/*!
+		\param n_threads Number of threads used to evaluate the population.
+		\param POP_SIZE Population size. Must be at least 4.
+
+		\param CR Mutation rate. Determines the chances
+			of a mutation happening. This value must be
+			between [0,1].
+		\param F Mutation weight. Determines how much
+			the mutation impacts each trials. This value
+			should be between [0,1].
+		\param callback_population_generator Function used to generate each
+			entity of the population. It must return a POP_TYPE type and use no
+			parameters. It is called by a single thread, in order.
+		\param callback_calc_error Function used to calculate the error with a single
+			member of the population. It must be thread safe.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE. It
+			must return a bool. In case of true, the population from the first ERROR_TYPE
+			will be picked as best candidate.
+		\param seed Seed of the random streams. Pass the same seed (and a
+			deterministic generator) to get the same results.
+	*/
+	ParallelDE(const uint32_t n_threads, const uint32_t POP_SIZE,
+		const double CR, const double F,
+		const std::function<POP_TYPE()>&& callback_population_generator,
+		const std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_error,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation,
+		const uint64_t seed = std::random_device{}()) :
+			BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE>(
+				CR, F,
+				std::move(callback_population_generator),
+				std::move(callback_calc_error),
+				std::move(callback_error_evaluation)),
+			kNThreads_{n_threads}, kPopSize_{POP_SIZE}, kSeed_{seed},
+			pool_(n_threads) {
+
+		initialize();
+	}
+
+	/*!
+		\param n_threads Number of threads used to evaluate the population.
+		\param POP_SIZE Population size. Must be at least 4.
+		\param CR Mutation rate.
+		\param F Mutation weight.
+		\param population_initializer Generates the entire initial population
+			inside its bounds. It is reseeded with `seed`. See PopulationInitializer.
+		\param callback_calc_error Function used to calculate the error with a single
+			member of the population. It must be thread safe.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE.
+		\param seed Seed of the random streams.
+	*/
+	ParallelDE(const uint32_t n_threads, const uint32_t POP_SIZE,
+		const double CR, const double F,
+		const PopulationInitializer<POP_TYPE,POP_DIM>& population_initializer,
+		const std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_error,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation,
+		const uint64_t seed = std::random_device{}()) :
+			BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE>(
+				CR, F,
+				population_initializer,
+				std::move(callback_calc_error),
+				std::move(callback_error_evaluation)),
+			kNThreads_{n_threads}, kPopSize_{POP_SIZE}, kSeed_{seed},
+			pool_(n_threads) {
+
+		initialize();
+	}
+
+	~ParallelDE() {
+
+	}
+
+	//! It solves one generation.
+	/*!
+		This is a blocking method.
+	*/
+	void solveOneGeneration() {
+		pool_.parallelFor(kPopSize_, chunkSize(),
+			[this](const uint32_t begin, const uint32_t end) {
+				for (uint32_t i = begin; i < end; ++i) {
+					this->evolve(i);
+				}
+			});
+		population_.swap(next_population_);
+		pop_errors_.swap(next_errors_);
+		++generation_;
+	}
+
+	void solveNGenerations(const uint32_t N) {
+		for (uint32_t g = 0; g < N; ++g) {
+			solveOneGeneration();
+		}
+	}
+
+	/*!
+		This operation has an O(N) complexity, where N is the population size.
+		Ties go to the lowest index, so it is deterministic too.
+	*/
+	std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>> getBestCandidate() {
+		auto e = std::min_element(pop_errors_.begin(), pop_errors_.end(),
+			this->callback_error_evaluation_);
+		auto min = std::distance(pop_errors_.begin(), e);
+
+		return std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>>{
+			pop_errors_[min],population_[min]};
+	}
+
+	//! Number of generations solved so far.
+	uint64_t getGeneration() const {
+		return generation_;
+	}
+
+private:
+	ThreadPool pool_;
+	uint64_t generation_{0};
+	const BinomialCrossover<POP_TYPE,POP_DIM> crossover_{this->kCR_};
+
+	std::vector<ERROR_TYPE> pop_errors_;
+	std::vector<std::array<POP_TYPE,POP_DIM>> next_population_;
+	std::vector<ERROR_TYPE> next_errors_;
+
+	// About 4 chunks per thread, enough to even out
+	// the cost differences between chunks
+	uint32_t chunkSize() const {
+		return std::max<uint32_t>(1, kPopSize_ / (kNThreads_ * 4));
+	}
+
+	void initialize() {
+		population_.resize(kPopSize_);
+		pop_errors_.resize(kPopSize_);
+		next_population_.resize(kPopSize_);
+		next_errors_.resize(kPopSize_);
+
+		if (this->population_initializer_) {
+			this->population_initializer_->seed(
+				static_cast<std::mt19937::result_type>(SplitMix64::mix(kSeed_)));
+			this->population_initializer_->generate(population_);
+		} else {
+			for (uint32_t i = 0; i < kPopSize_; ++i) {
+				for (int d = 0; d < POP_DIM; ++d) {
+					population_[i][d] = this->callback_population_generator_();
+				}
+			}
+		}
+
+		pool_.parallelFor(kPopSize_, chunkSize(),
+			[this](const uint32_t begin, const uint32_t end) {
+				for (uint32_t i = begin; i < end; ++i) {
+					this->pop_errors_[i] =
+						this->callback_calc_error_(this->population_[i]);
+				}
+			});
+
+		if (this->population_initializer_
+			&& this->population_initializer_->kOpposition_) {
+			oppositionSelection();
+		}
+	}
+
+	// Evaluates the opposite of every entity and keeps the best
+	// kPopSize_ of both populations
+	void oppositionSelection() {
+		using namespace std;
+		pool_.parallelFor(kPopSize_, chunkSize(),
+			[this](const uint32_t begin, const uint32_t end) {
+				for (uint32_t i = begin; i < end; ++i) {
+					this->next_population_[i] = this->population_initializer_
+						->opposite(this->population_[i]);
+					this->next_errors_[i] =
+						this->callback_calc_error_(this->next_population_[i]);
+				}
+			});
+
+		PopulationInitializer<POP_TYPE,POP_DIM>::selectOpposition(population_,
+			pop_errors_, next_population_, next_errors_,
+			this->callback_error_evaluation_);
+	}
+
+	// DE/rand/1/bin over the previous generation, then the selection.
+	// Only writes next_population_[i] and next_errors_[i].
+	void evolve(const uint32_t actual_index) {
+		SplitMix64 rng = SplitMix64::stream(kSeed_, generation_, actual_index);
+
+		const int j = rng.nextIndex(POP_DIM);
+
+		const uint32_t it0 = rng.nextIndex(kPopSize_);
+		uint32_t it1 = rng.nextIndex(kPopSize_);
+		while (it1 == it0) {
+			it1 = rng.nextIndex(kPopSize_);
+		}
+		uint32_t it2 = rng.nextIndex(kPopSize_);
+		while (it2 == it1 || it2 == it0) {
+			it2 = rng.nextIndex(kPopSize_);
+		}
+
+		const auto& a = population_[it0];
+		const auto& b = population_[it1];
+		const auto& c = population_[it2];
+		const auto& x = population_[actual_index];
+		std::array<POP_TYPE,POP_DIM> candidate;
+
+		const MutationType<POP_TYPE> F = static_cast<MutationType<POP_TYPE>>(this->kF_);
+		crossover_.apply(rng, j, F, a, b, c, x, candidate);
+
+		const ERROR_TYPE error_new = this->callback_calc_error_(candidate);
+		if (this->callback_error_evaluation_(error_new, pop_errors_[actual_index])) {
+			next_population_[actual_index] = candidate;
+			next_errors_[actual_index] = error_new;
+		} else {
+			next_population_[actual_index] = x;
+			next_errors_[actual_index] = pop_errors_[actual_index];
+		}
+	}
+};
+
+} // end namespace pdebc
+
+#endif /* PARALLELDE_HPP_ */
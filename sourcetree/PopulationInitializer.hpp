@@ -0,0 +1,214 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef POPULATIONINITIALIZER_HPP_
+#define POPULATIONINITIALIZER_HPP_
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <random>
+
+namespace pdebc {
+
+//! Sampling plans used by PopulationInitializer.
+enum class InitializationType {
+	UNIFORM, ///< Independent uniform samples (same as a uniform generator callback).
+	LATIN_HYPERCUBE, ///< Every dimension is split in N strata, each one is sampled exactly once.
+	HALTON ///< Low discrepancy Halton sequence, randomly shifted.
+};
+
+//! Generates the initial population inside box bounds.
+/*!
+	Unlike the generator callback, it knows the whole population size and
+	every dimension, so it can spread the population over the search space.
+
+	With opposition, the engines also evaluate the opposite of every
+	generated entity ( lower + upper - x ) and keep the best
+	half of both.
+
+	\tparam POP_TYPE Population data type (usually 'double')
+	\tparam POP_DIM Population dimensions (usually 2D or 3D)
+*/
+template <class POP_TYPE, int POP_DIM>
+struct PopulationInitializer {
+
+	const InitializationType kType_; ///< Sampling plan.
+	const bool kOpposition_; ///< Opposition based initialization.
+	const std::array<POP_TYPE,POP_DIM> kLowerBounds_; ///< Lower bound of each dimension.
+	const std::array<POP_TYPE,POP_DIM> kUpperBounds_; ///< Upper bound of each dimension.
+
+	/*!
+		\param type Sampling plan.
+		\param lower_bounds Lower bound of each dimension.
+		\param upper_bounds Upper bound of each dimension.
+		\param opposition Enables the opposition based initialization. It
+			doubles the number of initial evaluations.
+	*/
+	PopulationInitializer(const InitializationType type,
+		const std::array<POP_TYPE,POP_DIM>& lower_bounds,
+		const std::array<POP_TYPE,POP_DIM>& upper_bounds,
+		const bool opposition = false) :
+			kType_{type}, kOpposition_{opposition},
+			kLowerBounds_(lower_bounds), kUpperBounds_(upper_bounds),
+			emt_{std::random_device{}()} {
+
+	}
+
+	//! Fills every entity of `population`.
+	/*!
+		The sampling plan covers the entire vector, so generate the whole
+		population at once and split it afterwards.
+	*/
+	void generate(std::vector<std::array<POP_TYPE,POP_DIM>>& population) {
+		const uint32_t N = population.size();
+		if (N == 0) {
+			return;
+		}
+		std::uniform_real_distribution<double> ud(0.0, 1.0);
+
+		if (kType_ == InitializationType::LATIN_HYPERCUBE) {
+			std::vector<uint32_t> strata(N);
+			for (int d = 0; d < POP_DIM; ++d) {
+				for (uint32_t i = 0; i < N; ++i) {
+					strata[i] = i;
+				}
+				std::shuffle(strata.begin(), strata.end(), emt_);
+				for (uint32_t i = 0; i < N; ++i) {
+					population[i][d] = scale(d, (strata[i] + ud(emt_)) / N);
+				}
+			}
+		} else if (kType_ == InitializationType::HALTON) {
+			// Random shift (mod 1) of each dimension, so each call
+			// gives a different (but still low discrepancy) set.
+			std::array<double,POP_DIM> shift;
+			for (int d = 0; d < POP_DIM; ++d) {
+				shift[d] = ud(emt_);
+			}
+			uint32_t prime = 1;
+			for (int d = 0; d < POP_DIM; ++d) {
+				prime = nextPrime(prime);
+				for (uint32_t i = 0; i < N; ++i) {
+					double u = radicalInverse(i + 1, prime) + shift[d];
+					u -= static_cast<uint32_t>(u);
+					population[i][d] = scale(d, u);
+				}
+			}
+		} else {
+			for (uint32_t i = 0; i < N; ++i) {
+				for (int d = 0; d < POP_DIM; ++d) {
+					population[i][d] = scale(d, ud(emt_));
+				}
+			}
+		}
+	}
+
+	//! Restarts the random sequence, for reproducible sampling plans.
+	void seed(const std::mt19937::result_type value) {
+		emt_.seed(value);
+	}
+
+	//! Opposite point of `x`, ( lower + upper - x ).
+	std::array<POP_TYPE,POP_DIM> opposite(
+		const std::array<POP_TYPE,POP_DIM>& x) const {
+		std::array<POP_TYPE,POP_DIM> o;
+		for (int d = 0; d < POP_DIM; ++d) {
+			o[d] = kLowerBounds_[d] + kUpperBounds_[d] - x[d];
+		}
+		return o;
+	}
+
+	//! Keeps the best `population.size()` entities of `population` and
+	//! `opposites`, with their errors.
+	/*!
+		The sort is stable, so ties keep the generated entity first and
+		the result doesn't depend on the sort implementation.
+
+		\param population Generated entities, replaced by the selection.
+		\param errors Errors of `population`, replaced too.
+		\param opposites opposite() of every entity of `population`.
+		\param opposite_errors Errors of `opposites`.
+		\param error_evaluation Error comparison, true if the first is better.
+	*/
+	template <class ERROR_TYPE, class COMPARE>
+	static void selectOpposition(
+		std::vector<std::array<POP_TYPE,POP_DIM>>& population,
+		std::vector<ERROR_TYPE>& errors,
+		const std::vector<std::array<POP_TYPE,POP_DIM>>& opposites,
+		const std::vector<ERROR_TYPE>& opposite_errors,
+		const COMPARE& error_evaluation) {
+		const uint32_t N = population.size();
+		std::vector<uint32_t> order(N * 2);
+		for (uint32_t i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+		auto error = [&](const uint32_t i) -> const ERROR_TYPE& {
+			return i < N ? errors[i] : opposite_errors[i - N];
+		};
+		std::stable_sort(order.begin(), order.end(),
+			[&](const uint32_t a, const uint32_t b) {
+				return error_evaluation(error(a), error(b));
+			});
+
+		std::vector<std::array<POP_TYPE,POP_DIM>> selected(N);
+		std::vector<ERROR_TYPE> selected_errors(N);
+		for (uint32_t i = 0; i < N; ++i) {
+			const uint32_t k = order[i];
+			selected[i] = k < N ? population[k] : opposites[k - N];
+			selected_errors[i] = error(k);
+		}
+		population.swap(selected);
+		errors.swap(selected_errors);
+	}
+
+private:
+	std::mt19937 emt_;
+
+	POP_TYPE scale(const int d, const double u) const {
+		return static_cast<POP_TYPE>(kLowerBounds_[d]
+			+ u * (kUpperBounds_[d] - kLowerBounds_[d]));
+	}
+
+	static double radicalInverse(uint32_t i, const uint32_t base) {
+		const double inv_base = 1.0 / base;
+		double f = inv_base;
+		double r = 0;
+		while (i > 0) {
+			r += f * (i % base);
+			i /= base;
+			f *= inv_base;
+		}
+		return r;
+	}
+
+	static uint32_t nextPrime(uint32_t p) {
+		for (++p; ; ++p) {
+			bool prime = p > 1;
+			for (uint32_t k = 2; k * k <= p && prime; ++k) {
+				prime = (p % k) != 0;
+			}
+			if (prime) {
+				return p;
+			}
+		}
+	}
+};
+
+} // end namespace pdebc
+
+#endif /* POPULATIONINITIALIZER_HPP_ */
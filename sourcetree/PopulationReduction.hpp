@@ -0,0 +1,127 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef POPULATIONREDUCTION_HPP_
+#define POPULATIONREDUCTION_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+#include <vector>
+
+namespace pdebc {
+
+//! Population size as a function of the number of evaluations done.
+/*!
+	Used by SequentialDE::setPopulationReduction() and
+	ThreadsDE::setPopulationReduction(). After each generation the engines
+	evict their worst entities until the population fits the schedule.
+	The population never grows back.
+*/
+typedef std::function<uint32_t(uint64_t)> PopulationSchedule;
+
+//! Linear population size reduction (as in L-SHADE).
+/*!
+	\param initial_size Size at the start, usually the engine's population size.
+	\param final_size Size when `max_evaluations` evaluations are done.
+	\param max_evaluations Evaluation budget of the run.
+*/
+inline PopulationSchedule linearPopulationReduction(const uint32_t initial_size,
+	const uint32_t final_size, const uint64_t max_evaluations) {
+	return [=](const uint64_t evaluations) -> uint32_t {
+		const double progress = std::min(1.0,
+			static_cast<double>(evaluations) / std::max<uint64_t>(1, max_evaluations));
+		return static_cast<uint32_t>(initial_size
+			- progress * (static_cast<double>(initial_size) - final_size) + 0.5);
+	};
+}
+
+/// \cond DEV
+//! Indexes of the best `n` of `size` entities, in increasing order.
+/*!
+	\param better Compares two indexes, true if the first entity is better.
+*/
+template <class BETTER>
+std::vector<uint32_t> bestIndexes(const uint32_t size, const uint32_t n,
+	const BETTER& better) {
+	std::vector<uint32_t> order(size);
+	for (uint32_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::nth_element(order.begin(), order.begin() + n, order.end(), better);
+	// Survivors keep their relative order
+	order.resize(n);
+	std::sort(order.begin(), order.end());
+	return order;
+}
+
+//! Keeps only the elements at `indexes` (increasing), in a compacted storage.
+template <class T>
+void compactTo(std::vector<T>& v, const std::vector<uint32_t>& indexes) {
+	for (uint32_t i = 0; i < indexes.size(); ++i) {
+		v[i] = v[indexes[i]];
+	}
+	v.resize(indexes.size());
+	v.shrink_to_fit();
+}
+/// \endcond
+
+//! Keeps the best `n` entities, in a compacted storage.
+/*!
+	\param population Entities, shrunk to `n`.
+	\param errors Their errors, shrunk to `n`.
+	\param n New size.
+	\param error_evaluation Error comparison, true if the first one is better.
+*/
+template <class ENTITY, class ERROR_TYPE, class COMPARE>
+void evictWorst(std::vector<ENTITY>& population, std::vector<ERROR_TYPE>& errors,
+	const uint32_t n, const COMPARE& error_evaluation) {
+	if (n >= population.size()) {
+		return;
+	}
+	auto keep = bestIndexes(population.size(), n,
+		[&](const uint32_t a, const uint32_t b) {
+			return error_evaluation(errors[a], errors[b]);
+		});
+	compactTo(population, keep);
+	compactTo(errors, keep);
+}
+
+//! Keeps the best `n` entities of a constrained population.
+/*!
+	\param population Entities, shrunk to `n`.
+	\param errors Their errors, shrunk to `n`.
+	\param violations Their constraint violations, shrunk to `n`.
+	\param n New size.
+	\param better Compares two indexes, true if the first entity is better
+		(see ConstraintHandler::better()).
+*/
+template <class ENTITY, class ERROR_TYPE, class BETTER>
+void evictWorst(std::vector<ENTITY>& population, std::vector<ERROR_TYPE>& errors,
+	std::vector<double>& violations, const uint32_t n, const BETTER& better) {
+	if (n >= population.size()) {
+		return;
+	}
+	auto keep = bestIndexes(population.size(), n, better);
+	compactTo(population, keep);
+	compactTo(errors, keep);
+	compactTo(violations, keep);
+}
+
+} // end namespace pdebc
+
+#endif /* POPULATIONREDUCTION_HPP_ */
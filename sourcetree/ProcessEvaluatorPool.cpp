@@ -0,0 +1,242 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#include "ProcessEvaluatorPool.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace pdebc {
+
+ProcessEvaluatorPool::ProcessEvaluatorPool(
+	const std::vector<std::string>& command, const uint32_t n_workers,
+	const uint32_t batch_size, const uint32_t max_in_flight) :
+		kNWorkers_{std::max<uint32_t>(1, n_workers)},
+		kBatchSize_{std::max<uint32_t>(1, batch_size)},
+		kMaxInFlight_{std::max<uint32_t>(1, max_in_flight)} {
+
+	if (command.empty()) {
+		throw ProcessEvaluatorError("empty worker command");
+	}
+	try {
+		for (uint32_t w = 0; w < kNWorkers_; ++w) {
+			spawn(command);
+		}
+	} catch (...) {
+		shutdown();
+		throw;
+	}
+}
+
+ProcessEvaluatorPool::~ProcessEvaluatorPool() {
+	shutdown();
+}
+
+void ProcessEvaluatorPool::spawn(const std::vector<std::string>& command) {
+	// Built before fork(), the child only calls async signal safe functions
+	std::vector<char*> argv;
+	for (auto& a : command) {
+		argv.push_back(const_cast<char*>(a.c_str()));
+	}
+	argv.push_back(nullptr);
+
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		throw ProcessEvaluatorError(std::string("socketpair: ")
+			+ std::strerror(errno));
+	}
+	// The other workers must not inherit this end
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+	const pid_t pid = fork();
+	if (pid < 0) {
+		const int e = errno;
+		close(fds[0]);
+		close(fds[1]);
+		throw ProcessEvaluatorError(std::string("fork: ") + std::strerror(e));
+	}
+	if (pid == 0) {
+		dup2(fds[1], STDIN_FILENO);
+		dup2(fds[1], STDOUT_FILENO);
+		if (fds[1] != STDIN_FILENO && fds[1] != STDOUT_FILENO) {
+			close(fds[1]);
+		}
+		execvp(argv[0], argv.data());
+		_exit(127);
+	}
+	close(fds[1]);
+
+	Worker worker;
+	worker.pid = pid;
+	worker.fd = fds[0];
+	worker.out_offset = 0;
+	workers_.push_back(worker);
+}
+
+void ProcessEvaluatorPool::shutdown() {
+	// Closing the socket is the signal to exit
+	for (auto& w : workers_) {
+		close(w.fd);
+	}
+	for (auto& w : workers_) {
+		int status;
+		while (waitpid(w.pid, &status, 0) < 0 && errno == EINTR) {
+		}
+	}
+	workers_.clear();
+}
+
+void ProcessEvaluatorPool::evaluate(const double* candidates,
+	const uint32_t n, const uint32_t dim, double* errors) {
+	if (workers_.empty()) {
+		throw ProcessEvaluatorError("the worker processes are gone");
+	}
+
+	auto fail = [this](const std::string& what) {
+		// Replies of unknown requests may still arrive, the pool
+		// can't be reused. Don't wait for stuck workers.
+		for (auto& w : workers_) {
+			kill(w.pid, SIGKILL);
+		}
+		shutdown();
+		throw ProcessEvaluatorError(what);
+	};
+
+	const std::size_t kHeader = sizeof(uint32_t);
+	uint32_t next = 0;
+	uint32_t done = 0;
+	std::vector<pollfd> pfds(workers_.size());
+	std::vector<char> buffer(1 << 16);
+
+	while (done < n) {
+		// Keep every worker with kMaxInFlight_ requests, one level at a
+		// time so a short generation still reaches every worker
+		for (uint32_t depth = 1; depth <= kMaxInFlight_; ++depth) {
+			for (auto& w : workers_) {
+				if (w.in_flight.size() >= depth || next >= n) {
+					continue;
+				}
+				const uint32_t count = std::min(kBatchSize_, n - next);
+				const std::size_t bytes = count * dim * sizeof(double);
+				if (w.out_offset > 0) {
+					w.out.erase(w.out.begin(), w.out.begin() + w.out_offset);
+					w.out_offset = 0;
+				}
+				const std::size_t at = w.out.size();
+				w.out.resize(at + 2 * kHeader + bytes);
+				std::memcpy(&w.out[at], &count, kHeader);
+				std::memcpy(&w.out[at + kHeader], &dim, kHeader);
+				std::memcpy(&w.out[at + 2 * kHeader],
+					candidates + static_cast<std::size_t>(next) * dim, bytes);
+				w.in_flight.push_back(next);
+				next += count;
+			}
+		}
+
+		for (std::size_t k = 0; k < workers_.size(); ++k) {
+			const Worker& w = workers_[k];
+			pfds[k].fd = w.fd;
+			pfds[k].events = (w.out_offset < w.out.size() ? POLLOUT : 0)
+				| (w.in_flight.empty() ? 0 : POLLIN);
+			pfds[k].revents = 0;
+		}
+		if (poll(pfds.data(), pfds.size(), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fail(std::string("poll: ") + std::strerror(errno));
+		}
+
+		for (std::size_t k = 0; k < workers_.size(); ++k) {
+			Worker& w = workers_[k];
+			const short revents = pfds[k].revents;
+
+			if (revents & POLLOUT) {
+				const ssize_t s = send(w.fd, &w.out[w.out_offset],
+					w.out.size() - w.out_offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+				if (s < 0 && errno != EAGAIN && errno != EINTR) {
+					fail("worker " + std::to_string(w.pid)
+						+ " closed its input: " + std::strerror(errno));
+				}
+				if (s > 0) {
+					w.out_offset += s;
+				}
+				if (w.out_offset == w.out.size()) {
+					w.out.clear();
+					w.out_offset = 0;
+				}
+			}
+
+			if (revents & (POLLIN | POLLHUP | POLLERR)) {
+				const ssize_t r = recv(w.fd, buffer.data(), buffer.size(),
+					MSG_DONTWAIT);
+				if (r == 0) {
+					fail("worker " + std::to_string(w.pid) + " exited");
+				}
+				if (r < 0 && errno != EAGAIN && errno != EINTR) {
+					fail(std::string("recv: ") + std::strerror(errno));
+				}
+				if (r > 0) {
+					w.in.insert(w.in.end(), buffer.begin(), buffer.begin() + r);
+				}
+
+				// Every complete reply goes to its place in `errors`
+				std::size_t consumed = 0;
+				while (w.in.size() - consumed >= kHeader) {
+					if (w.in_flight.empty()) {
+						fail("worker " + std::to_string(w.pid)
+							+ " sent an unexpected reply");
+					}
+					uint32_t count;
+					std::memcpy(&count, &w.in[consumed], kHeader);
+					const uint32_t first = w.in_flight.front();
+					if (count != std::min(kBatchSize_, n - first)) {
+						fail("worker " + std::to_string(w.pid)
+							+ " replied with the wrong number of errors");
+					}
+					const std::size_t bytes = count * sizeof(double);
+					if (w.in.size() - consumed < kHeader + bytes) {
+						break;
+					}
+					std::memcpy(errors + first, &w.in[consumed + kHeader], bytes);
+					consumed += kHeader + bytes;
+					w.in_flight.pop_front();
+					done += count;
+				}
+				w.in.erase(w.in.begin(), w.in.begin() + consumed);
+			}
+		}
+	}
+}
+
+std::function<void(const double*,uint32_t,uint32_t,double*)>
+ProcessEvaluatorPool::callback() {
+	return [this](const double* candidates, uint32_t n, uint32_t dim,
+		double* errors) {
+		this->evaluate(candidates, n, dim, errors);
+	};
+}
+
+} // end namespace pdebc
@@ -0,0 +1,119 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef PROCESSEVALUATORPOOL_HPP_
+#define PROCESSEVALUATORPOOL_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+
+namespace pdebc {
+
+//! Evaluates candidates in long lived worker processes.
+/*!
+	Starts `n_workers` copies of an external program once, and streams
+	batches of candidates to them. Each worker has a few batches in flight,
+	so while one batch is being evaluated the next is already in its
+	input, and the workers never wait for the solver.
+
+	Each worker talks through its stdin/stdout (a Unix socket), with native
+	endianness frames:
+
+	- request: `uint32 n`, `uint32 dim`, `n * dim` doubles (row major);
+	- reply: `uint32 n`, `n` doubles (one error per candidate, same order).
+
+	Replies must come in the same order as the requests. The worker should
+	exit when its stdin is closed.
+
+	ProcessEvaluatorPool::evaluate() has the signature of the DynamicDE
+	batch callback, see ProcessEvaluatorPool::callback().
+	Errors (worker died, bad reply...) are reported with
+	ProcessEvaluatorError.
+*/
+struct ProcessEvaluatorPool {
+
+	const uint32_t kNWorkers_; ///< Number of worker processes.
+	const uint32_t kBatchSize_; ///< Candidates per request.
+	const uint32_t kMaxInFlight_; ///< Requests sent to a worker before its first reply.
+
+	/*!
+		\param command Program and its arguments, looked up in the PATH.
+		\param n_workers Number of worker processes.
+		\param batch_size Candidates per request. Smaller batches balance
+			better between workers, larger ones have less overhead.
+		\param max_in_flight Requests each worker may have queued.
+	*/
+	ProcessEvaluatorPool(const std::vector<std::string>& command,
+		const uint32_t n_workers, const uint32_t batch_size = 16,
+		const uint32_t max_in_flight = 2);
+
+	//! Closes the workers' input and waits for them to exit.
+	~ProcessEvaluatorPool();
+
+	ProcessEvaluatorPool(const ProcessEvaluatorPool&) = delete;
+	ProcessEvaluatorPool& operator=(const ProcessEvaluatorPool&) = delete;
+
+	//! Calculates the errors of `n` candidates.
+	/*!
+		This is a blocking method. The batches are spread over the workers
+		as they reply, and the errors are written back in order.
+
+		\param candidates Row major (n x dim) block of candidates.
+		\param n Number of candidates.
+		\param dim Dimensions of each candidate.
+		\param errors Output, `n` errors.
+	*/
+	void evaluate(const double* candidates, const uint32_t n,
+		const uint32_t dim, double* errors);
+
+	//! ProcessEvaluatorPool::evaluate() as a DynamicDE batch callback.
+	/*!
+		The pool must outlive the returned function.
+	*/
+	std::function<void(const double*,uint32_t,uint32_t,double*)> callback();
+
+private:
+	struct Worker {
+		int pid;
+		int fd;
+		std::vector<char> out; // Bytes still to be sent
+		std::size_t out_offset;
+		std::vector<char> in; // Bytes of the reply being received
+		std::deque<uint32_t> in_flight; // First candidate of each request sent
+	};
+
+	std::vector<Worker> workers_;
+
+	void spawn(const std::vector<std::string>& command);
+	void shutdown();
+};
+
+//! Thrown when a worker process fails.
+struct ProcessEvaluatorError : public std::runtime_error {
+	explicit ProcessEvaluatorError(const std::string& what) :
+		std::runtime_error(what) {
+
+	}
+};
+
+} // end namespace pdebc
+
+#endif /* PROCESSEVALUATORPOOL_HPP_ */
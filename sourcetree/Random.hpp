@@ -0,0 +1,88 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef RANDOM_HPP_
+#define RANDOM_HPP_
+
+#include <cstdint>
+#include <limits>
+
+namespace pdebc {
+
+//! Small and fast random engine (SplitMix64).
+/*!
+	Meets the UniformRandomBitGenerator requirements, so it works with the
+	<random> distributions. Its state is a single counter, so creating one
+	per entity per generation is cheap. See SplitMix64::stream().
+*/
+struct SplitMix64 {
+
+	typedef uint64_t result_type;
+
+	explicit SplitMix64(const uint64_t seed = 0) : state_{seed} {
+
+	}
+
+	//! Engine whose sequence depends only on (`seed`, `a`, `b`).
+	/*!
+		Used to give every (generation, entity) pair its own sequence, so
+		the results don't depend on which thread handles it.
+	*/
+	static SplitMix64 stream(const uint64_t seed, const uint64_t a,
+		const uint64_t b) {
+		return SplitMix64(mix(seed ^ mix(a ^ mix(b))));
+	}
+
+	//! SplitMix64 finalizer, a bijective 64 bits hash.
+	static uint64_t mix(uint64_t z) {
+		z += 0x9E3779B97F4A7C15ull;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t operator()() {
+		const uint64_t z = mix(state_);
+		state_ += 0x9E3779B97F4A7C15ull;
+		return z;
+	}
+
+	//! Uniform double in [0,1).
+	double nextDouble() {
+		return ((*this)() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	//! Uniform integer in [0,n).
+	uint32_t nextIndex(const uint32_t n) {
+		return static_cast<uint32_t>((((*this)() >> 32) * n) >> 32);
+	}
+
+	static constexpr uint64_t min() {
+		return 0;
+	}
+
+	static constexpr uint64_t max() {
+		return std::numeric_limits<uint64_t>::max();
+	}
+
+private:
+	uint64_t state_;
+};
+
+} // end namespace pdebc
+
+#endif /* RANDOM_HPP_ */
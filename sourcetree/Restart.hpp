@@ -0,0 +1,149 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef RESTART_HPP_
+#define RESTART_HPP_
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <random>
+
+#include "BaseDE.hpp"
+
+namespace pdebc {
+
+//! What a restart does with the population.
+enum class RestartType {
+	IPOP, ///< New random population, larger each time (IPOP-CMA-ES style).
+	LOCAL ///< New population of the same size around the best entity so far.
+};
+
+//! When and how SequentialDE and ThreadsDE restart a stagnated population.
+/*!
+	The population has stagnated when its best error didn't improve for
+	RestartPolicy::kStagnation_ generations. The best entity ever found
+	(the elite) survives every restart, and getBestCandidate() considers it.
+*/
+struct RestartPolicy {
+
+	const RestartType kType_; ///< What to do on a restart.
+	const uint32_t kStagnation_; ///< Generations without improvement before restarting.
+	const double kGrowth_; ///< IPOP: population size multiplier of each restart.
+	const uint32_t kMaxPopSize_; ///< IPOP: population size limit.
+	const double kRadius_; ///< LOCAL: half width of the box around the best, relative to the search range.
+	const uint32_t kMaxRestarts_; ///< Restarts allowed.
+
+	/*!
+		\param type What to do on a restart.
+		\param stagnation Generations without improvement before restarting.
+		\param growth IPOP: population size multiplier of each restart.
+		\param radius LOCAL: half width of the box around the best entity, as
+			a fraction of the search range (initializer bounds, or the spread
+			of the generator callback).
+		\param max_pop_size IPOP: population size limit.
+		\param max_restarts Restarts allowed.
+	*/
+	RestartPolicy(const RestartType type, const uint32_t stagnation = 50,
+		const double growth = 2.0, const double radius = 0.1,
+		const uint32_t max_pop_size = 100000,
+		const uint32_t max_restarts = std::numeric_limits<uint32_t>::max()) :
+			kType_{type}, kStagnation_{std::max<uint32_t>(1, stagnation)},
+			kGrowth_{growth}, kMaxPopSize_{max_pop_size}, kRadius_{radius},
+			kMaxRestarts_{max_restarts} {
+
+	}
+
+	//! Population size after a restart of a population of size `n`.
+	uint32_t nextPopSize(const uint32_t n) const {
+		if (kType_ != RestartType::IPOP) {
+			return n;
+		}
+		return std::max(n, std::min(kMaxPopSize_,
+			static_cast<uint32_t>(n * kGrowth_ + 0.5)));
+	}
+};
+
+/// \cond DEV
+//! Width of the search space in each dimension.
+/*!
+	The initializer's bounds when there's one. Otherwise the spread of
+	some samples of the generator callback.
+*/
+template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
+std::array<double,POP_DIM> searchRange(
+	const BaseDE<POP_TYPE,POP_DIM,ERROR_TYPE>& de) {
+	std::array<double,POP_DIM> range;
+	if (de.population_initializer_) {
+		for (int d = 0; d < POP_DIM; ++d) {
+			range[d] = static_cast<double>(de.population_initializer_->kUpperBounds_[d])
+				- de.population_initializer_->kLowerBounds_[d];
+		}
+		return range;
+	}
+	std::array<double,POP_DIM> lo;
+	std::array<double,POP_DIM> hi;
+	lo.fill(std::numeric_limits<double>::max());
+	hi.fill(std::numeric_limits<double>::lowest());
+	for (int s = 0; s < 64; ++s) {
+		for (int d = 0; d < POP_DIM; ++d) {
+			const double v = static_cast<double>(de.callback_population_generator_());
+			lo[d] = std::min(lo[d], v);
+			hi[d] = std::max(hi[d], v);
+		}
+	}
+	for (int d = 0; d < POP_DIM; ++d) {
+		range[d] = hi[d] - lo[d];
+	}
+	return range;
+}
+
+//! Fills `population` with uniform samples in the box ( center +- radius * range ).
+/*!
+	With an initializer, samples past its bounds are reflected back
+	inside (and clamped, if the box is wider than the bounds).
+*/
+template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
+void sampleAround(const BaseDE<POP_TYPE,POP_DIM,ERROR_TYPE>& de,
+	const std::array<POP_TYPE,POP_DIM>& center, const double radius,
+	std::vector<std::array<POP_TYPE,POP_DIM>>& population, std::mt19937& emt) {
+	const std::array<double,POP_DIM> range = searchRange(de);
+	std::uniform_real_distribution<double> ud(-1.0, 1.0);
+	for (auto& x : population) {
+		for (int d = 0; d < POP_DIM; ++d) {
+			double v = center[d] + radius * range[d] * ud(emt);
+			if (de.population_initializer_) {
+				const double lo = de.population_initializer_->kLowerBounds_[d];
+				const double hi = de.population_initializer_->kUpperBounds_[d];
+				if (v < lo) {
+					v = lo + (lo - v);
+				} else if (v > hi) {
+					v = hi - (v - hi);
+				}
+				v = std::min(hi, std::max(lo, v));
+			}
+			x[d] = static_cast<POP_TYPE>(v);
+		}
+	}
+}
+/// \endcond
+
+} // end namespace pdebc
+
+#endif /* RESTART_HPP_ */
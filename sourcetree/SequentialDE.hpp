@@ -25,8 +25,18 @@
 #include <algorithm>
 #include <functional>
 #include <random>
+#include <thread>
+#include <memory>
 
 #include "BaseDE.hpp"
+#include "PopulationReduction.hpp"
+#include "Surrogate.hpp"
+#include "Restart.hpp"
+#include "LocalSearch.hpp"
+#include "Constraints.hpp"
+#include "VariableTypes.hpp"
+#include "Crossover.hpp"
+#include "Random.hpp"
 
 namespace pdebc {
 
@@ -39,7 +49,7 @@ namespace pdebc {
 template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
 struct SequentialDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 
-	const uint32_t kPopSize_; ///< Population size;
+	const uint32_t kPopSize_; ///< Initial population size. See SequentialDE::getPopSize().
 	std::vector<std::array<POP_TYPE,POP_DIM>> population_; ///< Entire population.
 
 	/*!
@@ -60,11 +70,15 @@ struct SequentialDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE. It
 			must return a bool. In case of true, the population from the first ERROR_TYPE
 			will be picked as best candidate. Try to figure out what happens in case of false xD.
+		\param n_init_threads Number of threads used to calculate the error of
+			the initial population (and of the restarted ones). With more than
+			one, `callback_calc_error` must be thread safe.
 	*/
 	SequentialDE(const uint32_t POP_SIZE, const double CR, const double F,
 		const std::function<POP_TYPE()>&& callback_population_generator,
 		const std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_error,
-		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation) :
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation,
+		const uint32_t n_init_threads = 1) :
 			kPopSize_{POP_SIZE},
 			BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE>(
 				CR, F,
@@ -72,28 +86,37 @@ struct SequentialDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 				std::move(callback_calc_error),
 				std::move(callback_error_evaluation)) {
 
-		population_.resize(kPopSize_);
-		pop_errors_.resize(kPopSize_);
-		
-		// Initialize random_cr_
-		using namespace std;
-		random_device rd;
-  		mt19937 emt(rd());
-  		uniform_real_distribution<double> ud(0.0, 1.0);
-  		random_cr_ = bind(ud, emt);
+		initialize(n_init_threads);
+	}
 
-  		// Initialize random_trials_
-  		mt19937 emt2(rd());
-  		uniform_int_distribution<uint32_t> ui2(0, kPopSize_-1);
-  		random_trials_ = bind(ui2, emt2);
+	/*!
+		\param POP_SIZE Population size.
 
-  		// Initialize random_j_
-  		mt19937 emt3(rd());
-  		uniform_int_distribution<uint32_t> ui3(0.0, POP_DIM-1);
-  		random_j_ = bind(ui3, emt3);
+		\param CR Mutation rate.
+		\param F Mutation weight.
+		\param population_initializer Generates the entire initial population
+			inside its bounds (Latin hypercube, Halton, opposition based...).
+			See PopulationInitializer.
+		\param callback_calc_error Function used to calculate the error with a single
+			member of the population.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE.
+		\param n_init_threads Number of threads used to calculate the error of
+			the initial population (and of the restarted ones). With more than
+			one, `callback_calc_error` must be thread safe.
+	*/
+	SequentialDE(const uint32_t POP_SIZE, const double CR, const double F,
+		const PopulationInitializer<POP_TYPE,POP_DIM>& population_initializer,
+		const std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_error,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation,
+		const uint32_t n_init_threads = 1) :
+			kPopSize_{POP_SIZE},
+			BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE>(
+				CR, F,
+				population_initializer,
+				std::move(callback_calc_error),
+				std::move(callback_error_evaluation)) {
 
-		generatePopulation();
-		calcGenerationError();
+		initialize(n_init_threads);
 	}
 
 	~SequentialDE() {
@@ -101,10 +124,25 @@ struct SequentialDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 	}
 
 	void solveOneGeneration() {
-		for (uint32_t i = 0; i < kPopSize_; i++) {
+		const uint32_t N = population_.size();
+		for (uint32_t i = 0; i < N; i++) {
 			mutation(i);
 			select(i);
 		}
+		++generation_;
+		if (population_schedule_) {
+			evictWorst(population_, pop_errors_, pop_violations_,
+				std::max(kMinPopSize_, population_schedule_(evaluations_)),
+				[this](const uint32_t a, const uint32_t b) {
+					return this->better(a, b);
+				});
+		}
+		if (restart_policy_) {
+			checkStagnation();
+		}
+		if (local_search_) {
+			polish();
+		}
 	}
 
 	void solveNGenerations(const uint32_t N) {
@@ -115,91 +153,516 @@ struct SequentialDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 
 	/*!
 		This operation has an O(N) complexity, where N is the population size.
+
+		With constraints, the best entity follows Deb's rules (see
+		ConstraintHandler). While no entity is feasible, the returned error
+		is not meaningful.
 	*/
 	std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>> getBestCandidate() {
 		
-		auto e = std::min_element(pop_errors_.begin(), pop_errors_.end(),
-			this->callback_error_evaluation_);
-		auto min = std::distance(pop_errors_.begin(), e);
+		const uint32_t min = bestIndex();
 
 		std::array<POP_TYPE,POP_DIM> r = population_[min];
 
+		if (restarts_ > 0 && better(std::get<0>(elite_), elite_violation_,
+				pop_errors_[min], pop_violations_[min])) {
+			return elite_;
+		}
 		return std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>>{pop_errors_[min],r};
 	}
 
+	//! Restarts the population when it stagnates.
+	/*!
+		The population is regenerated in place (IPOP: larger and random,
+		LOCAL: around the best entity), and evaluated with the
+		`n_init_threads` threads given to the constructor. The best entity
+		found before the restart is still returned by getBestCandidate()
+		when nothing better is found. See RestartPolicy.
+	*/
+	void setRestartPolicy(const RestartPolicy& policy) {
+		restart_policy_ = std::make_shared<RestartPolicy>(policy);
+		auto best = getBestCandidate();
+		stagnation_best_ = std::get<0>(best);
+		elite_ = best;
+		elite_violation_ = violation(std::get<1>(best));
+		stagnation_violation_ = elite_violation_;
+		stagnant_generations_ = 0;
+	}
 
-private:
-	std::function<double()> random_cr_;
-	std::function<uint32_t()> random_trials_;
-	std::function<uint32_t()> random_j_;
+	//! Number of restarts so far.
+	uint32_t getRestarts() const {
+		return restarts_;
+	}
+
+	//! Polishes the best entity with a local search, next to the DE loop.
+	/*!
+		Every `period` generations (once the previous search is done), a
+		Nelder-Mead search starts from the best entity on another thread,
+		while the generations go on. Its initial simplex is half of the
+		population's spread. When it ends, its result replaces the worst
+		entity if it beats the best one. Its evaluations are added to
+		getEvaluations().
+
+		`callback_calc_error` is called by both threads, so it must be
+		thread safe.
+
+		\param period Generations between the searches.
+		\param max_evaluations Evaluation budget of each search.
+	*/
+	void setLocalSearch(const uint32_t period,
+		const uint32_t max_evaluations = 200 * POP_DIM) {
+		local_search_ = std::make_shared<LocalSearchRunner<POP_TYPE,POP_DIM,ERROR_TYPE>>(
+			period, max_evaluations);
+	}
+
+	//! Shrinks the population along the run.
+	/*!
+		After each generation, the worst entities are evicted until the
+		population size is `schedule(evaluations)` (never less than 4).
+		Late in the run, evaluations go only to the entities that can still
+		win. See linearPopulationReduction().
+	*/
+	void setPopulationReduction(const PopulationSchedule& schedule) {
+		population_schedule_ = schedule;
+	}
+
+	//! Current population size.
+	uint32_t getPopSize() const {
+		return population_.size();
+	}
+
+	//! Current population.
+	const std::vector<std::array<POP_TYPE,POP_DIM>>& getPopulation() const {
+		return population_;
+	}
+
+	//! Errors of the current population, same order as getPopulation().
+	const std::vector<ERROR_TYPE>& getErrors() const {
+		return pop_errors_;
+	}
+
+	//! Number of evaluations done so far, the initial population included.
+	uint64_t getEvaluations() const {
+		return evaluations_;
+	}
+
+	//! Pre-screens the trials with a model of the error function.
+	/*!
+		Trials predicted to lose against their target are discarded without
+		being evaluated (see KNNSurrogate::promising()). The model learns from
+		the current population and from every evaluation after this call.
+	*/
+	void setSurrogate(const KNNSurrogate<POP_TYPE,POP_DIM,ERROR_TYPE>& surrogate) {
+		surrogate_ = std::make_shared<KNNSurrogate<POP_TYPE,POP_DIM,ERROR_TYPE>>(
+			surrogate);
+		for (uint32_t i = 0; i < population_.size(); ++i) {
+			if (feasible(pop_violations_[i])) {
+				surrogate_->add(population_[i], pop_errors_[i]);
+			}
+		}
+	}
 
-	template <class T, unsigned I, unsigned J>
-	using Matrix = std::array<std::array<T, J>, I>;
+	//! Number of trials discarded by the surrogate.
+	uint64_t getSkippedEvaluations() const {
+		return skipped_evaluations_;
+	}
 
-	Matrix<POP_TYPE, 3, POP_DIM> pop_trials_; // Used in "mutation"
+	//! Checks the constraints of every trial before its error.
+	/*!
+		Trials violating the constraints (by more than the epsilon level)
+		are compared with their target by the violation only, without
+		calling the error function. Every comparison follows Deb's rules.
+		See ConstraintHandler.
+	*/
+	void setConstraints(const ConstraintHandler<POP_TYPE,POP_DIM>& constraints) {
+		constraints_ = std::make_shared<ConstraintHandler<POP_TYPE,POP_DIM>>(
+			constraints);
+		for (uint32_t i = 0; i < population_.size(); ++i) {
+			pop_violations_[i] = violation(population_[i]);
+		}
+		if (restart_policy_) {
+			const uint32_t best = bestIndex();
+			stagnation_best_ = pop_errors_[best];
+			stagnation_violation_ = pop_violations_[best];
+			elite_violation_ = violation(std::get<1>(elite_));
+		}
+	}
+
+	//! Number of trials rejected by the constraints, without an evaluation.
+	uint64_t getInfeasibleTrials() const {
+		return infeasible_trials_;
+	}
+
+	//! Makes some dimensions integer or categorical.
+	/*!
+		Every trial is repaired after the crossover (see VariableTypes),
+		and so are the restarted populations and the local search vertices.
+		The current population is repaired now, and the entities it changes
+		are evaluated again.
+	*/
+	void setVariableTypes(const VariableTypes<POP_DIM>& types) {
+		static_assert(std::is_floating_point<POP_TYPE>::value,
+			"VariableTypes needs a floating point POP_TYPE");
+		variable_types_ = std::make_shared<const VariableTypes<POP_DIM>>(types);
+		for (uint32_t i = 0; i < population_.size(); ++i) {
+			if (variable_types_->repair(population_[i])) {
+				pop_violations_[i] = violation(population_[i]);
+				if (feasible(pop_violations_[i])) {
+					pop_errors_[i] = this->callback_calc_error_(population_[i]);
+					++evaluations_;
+				}
+			}
+		}
+		if (restart_policy_) {
+			const uint32_t best = bestIndex();
+			stagnation_best_ = pop_errors_[best];
+			stagnation_violation_ = pop_violations_[best];
+		}
+	}
+
+
+private:
+	SplitMix64 emt_crossover_;
+	const BinomialCrossover<POP_TYPE,POP_DIM> crossover_{this->kCR_};
+	std::mt19937 emt_trials_;
+	std::function<uint32_t()> random_j_;
 	std::array<POP_TYPE, POP_DIM> pop_candidate_;
 	std::vector<ERROR_TYPE> pop_errors_;
+	std::vector<double> pop_violations_; // All 0 without constraints
+
+	// The population may shrink between generations
+	uint32_t randomTrial() {
+		return std::uniform_int_distribution<uint32_t>(
+			0, population_.size()-1)(emt_trials_);
+	}
+
+	// DE needs 3 entities besides the one being mutated
+	static constexpr uint32_t kMinPopSize_ = 4;
+	PopulationSchedule population_schedule_;
+	uint64_t evaluations_{0};
+	std::shared_ptr<KNNSurrogate<POP_TYPE,POP_DIM,ERROR_TYPE>> surrogate_;
+	uint64_t skipped_evaluations_{0};
+
+	std::shared_ptr<ConstraintHandler<POP_TYPE,POP_DIM>> constraints_;
+	uint64_t generation_{0}; // Sets the epsilon level
+	uint64_t infeasible_trials_{0};
+
+	std::shared_ptr<const VariableTypes<POP_DIM>> variable_types_;
+
+	uint32_t n_threads_{1}; // Used by the initial evaluation and the restarts
+	std::shared_ptr<RestartPolicy> restart_policy_;
+	std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>> elite_;
+	double elite_violation_{0};
+	ERROR_TYPE stagnation_best_;
+	double stagnation_violation_{0};
+	uint32_t stagnant_generations_{0};
+	uint32_t restarts_{0};
+	std::mt19937 emt_restart_;
+
+	std::shared_ptr<LocalSearchRunner<POP_TYPE,POP_DIM,ERROR_TYPE>> local_search_;
+
+	void polish() {
+		using namespace std;
+		auto cmp = this->callback_error_evaluation_;
+		const uint32_t best = bestIndex();
+
+		tuple<ERROR_TYPE,array<POP_TYPE,POP_DIM>,uint32_t> r;
+		if (local_search_->poll(r)) {
+			evaluations_ += get<2>(r);
+			const double v = violation(get<1>(r));
+			if (better(get<0>(r), v, pop_errors_[best], pop_violations_[best])) {
+				const uint32_t worst = worstIndex();
+				population_[worst] = get<1>(r);
+				pop_errors_[worst] = get<0>(r);
+				pop_violations_[worst] = v;
+				if (surrogate_) {
+					surrogate_->add(get<1>(r), get<0>(r));
+				}
+			}
+		}
+		// The search needs the error of its starting point
+		if (local_search_->tick() && feasible(pop_violations_[best])) {
+			local_search_->start(this->callback_calc_error_, cmp,
+				population_[best], pop_errors_[best],
+				LocalSearchRunner<POP_TYPE,POP_DIM,ERROR_TYPE>::steps(population_),
+				constraints_, constraints_ ? constraints_->epsilon(generation_) : 0,
+				variable_types_);
+		}
+	}
+
+	void checkStagnation() {
+		const uint32_t best = bestIndex();
+		if (better(pop_errors_[best], pop_violations_[best],
+				stagnation_best_, stagnation_violation_)) {
+			stagnation_best_ = pop_errors_[best];
+			stagnation_violation_ = pop_violations_[best];
+			stagnant_generations_ = 0;
+		} else {
+			++stagnant_generations_;
+		}
+		if (better(pop_errors_[best], pop_violations_[best],
+				std::get<0>(elite_), elite_violation_)) {
+			elite_ = std::make_tuple(pop_errors_[best], population_[best]);
+			elite_violation_ = pop_violations_[best];
+		}
+		if (stagnant_generations_ >= restart_policy_->kStagnation_
+			&& restarts_ < restart_policy_->kMaxRestarts_) {
+			restart();
+		}
+	}
+
+	// Same buffers, same threads: only the contents change
+	void restart() {
+		const uint32_t N = restart_policy_->nextPopSize(population_.size());
+		population_.resize(N);
+		pop_errors_.resize(N);
+		pop_violations_.resize(N);
+		if (restart_policy_->kType_ == RestartType::IPOP) {
+			generatePopulation();
+		} else {
+			sampleAround<POP_TYPE,POP_DIM,ERROR_TYPE>(*this, std::get<1>(elite_), restart_policy_->kRadius_,
+				population_, emt_restart_);
+			population_[0] = std::get<1>(elite_);
+		}
+		if (variable_types_) {
+			for (auto& x : population_) {
+				variable_types_->repair(x);
+			}
+		}
+		evaluations_ += calcGenerationError(population_, pop_errors_,
+			pop_violations_, n_threads_);
+		if (surrogate_) {
+			for (uint32_t i = 0; i < N; ++i) {
+				if (feasible(pop_violations_[i])) {
+					surrogate_->add(population_[i], pop_errors_[i]);
+				}
+			}
+		}
+
+		++restarts_;
+		stagnant_generations_ = 0;
+		const uint32_t best = bestIndex();
+		stagnation_best_ = pop_errors_[best];
+		stagnation_violation_ = pop_violations_[best];
+	}
+
+	void initialize(const uint32_t n_init_threads) {
+		population_.resize(kPopSize_);
+		pop_errors_.resize(kPopSize_);
+		pop_violations_.assign(kPopSize_, 0);
+		n_threads_ = n_init_threads;
+		
+		// Initialize the crossover mask's engine
+		using namespace std;
+		random_device rd;
+		emt_crossover_ = SplitMix64((static_cast<uint64_t>(rd()) << 32) | rd());
+
+  		// Initialize randomTrial()
+  		emt_trials_.seed(rd());
+  		emt_restart_.seed(rd());
+
+  		// Initialize random_j_
+  		mt19937 emt3(rd());
+  		uniform_int_distribution<uint32_t> ui3(0.0, POP_DIM-1);
+  		random_j_ = bind(ui3, emt3);
+
+		generatePopulation();
+		evaluations_ = calcGenerationError(population_, pop_errors_,
+			pop_violations_, n_init_threads);
+
+		if (this->population_initializer_
+			&& this->population_initializer_->kOpposition_) {
+			oppositionSelection(n_init_threads);
+			evaluations_ += kPopSize_;
+		}
+	}
 
 	void generatePopulation() {
-		for (uint32_t i = 0; i < kPopSize_; ++i) {
+		if (this->population_initializer_) {
+			this->population_initializer_->generate(population_);
+			return;
+		}
+		for (uint32_t i = 0; i < population_.size(); ++i) {
 			for (int d = 0; d < POP_DIM; ++d) {
 				population_[i][d] = this->callback_population_generator_();
 			}
 		}
 	}
 
-	void calcGenerationError() {
+	// Each thread calculates the errors of a contiguous chunk. Entities
+	// violating the constraints are not evaluated.
+	// Returns the number of evaluations.
+	uint32_t calcGenerationError(
+		const std::vector<std::array<POP_TYPE,POP_DIM>>& population,
+		std::vector<ERROR_TYPE>& errors, std::vector<double>& violations,
+		const uint32_t n_threads) {
+		const uint32_t N = population.size();
+		const uint32_t nt = std::max<uint32_t>(1, std::min(n_threads, N));
+		std::vector<uint32_t> evaluations(nt, 0);
+		auto work = [this,&population,&errors,&violations,&evaluations,N,nt](
+			const uint32_t t) {
+			for (uint32_t i = t * N / nt; i < (t + 1) * N / nt; ++i) {
+				violations[i] = this->violation(population[i]);
+				if (this->feasible(violations[i])) {
+					errors[i] = this->callback_calc_error_(population[i]);
+					++evaluations[t];
+				}
+			}
+		};
+		std::vector<std::thread> threads;
+		for (uint32_t t = 1; t < nt; ++t) {
+			threads.push_back(std::thread(work, t));
+		}
+		work(0);
+		for (auto& t : threads) {
+			t.join();
+		}
+		uint32_t total = 0;
+		for (auto e : evaluations) {
+			total += e;
+		}
+		return total;
+	}
+
+	// Evaluates the opposite of every entity and keeps the best
+	// kPopSize_ of both populations. Only called by the constructors,
+	// before any constraint is set.
+	void oppositionSelection(const uint32_t n_threads) {
+		using namespace std;
+		vector<array<POP_TYPE,POP_DIM>> opposites(kPopSize_);
+		vector<ERROR_TYPE> opposite_errors(kPopSize_);
+		vector<double> opposite_violations(kPopSize_);
 		for (uint32_t i = 0; i < kPopSize_; ++i) {
-			pop_candidate_ = population_[i];
-			pop_errors_[i] = this->callback_calc_error_(pop_candidate_);
+			opposites[i] = this->population_initializer_->opposite(population_[i]);
 		}
+		calcGenerationError(opposites, opposite_errors, opposite_violations,
+			n_threads);
+
+		PopulationInitializer<POP_TYPE,POP_DIM>::selectOpposition(population_,
+			pop_errors_, opposites, opposite_errors,
+			this->callback_error_evaluation_);
 	}
 
 	void mutation(const uint32_t actual_index) {
-		int j = random_j_();
+		const int j = random_j_();
+		const MutationType<POP_TYPE> F = static_cast<MutationType<POP_TYPE>>(this->kF_);
 
-		const uint32_t it0 = random_trials_();
-		uint32_t it1 = random_trials_();
+		const uint32_t it0 = randomTrial();
+		uint32_t it1 = randomTrial();
 		while (it1 == it0) {
-			it1 = random_trials_();
+			it1 = randomTrial();
 		}
-		uint32_t it2 = random_trials_();
+		uint32_t it2 = randomTrial();
 		while (it2 == it1 || it2 == it0) {
-			it2 = random_trials_();
+			it2 = randomTrial();
 		}
 
-		for (int d = 0; d < POP_DIM; d++) {
-			pop_trials_[0][d] = population_[it0][d];
-			pop_trials_[1][d] = population_[it1][d];
-			pop_trials_[2][d] = population_[it2][d];
+		crossover_.apply(emt_crossover_, j, F, population_[it0],
+			population_[it1], population_[it2], population_[actual_index],
+			pop_candidate_);
+		if (variable_types_) {
+			variable_types_->repair(pop_candidate_);
 		}
-
-		pop_candidate_[j] = pop_trials_[0][j] + this->kF_ * (pop_trials_[1][j] - pop_trials_[2][j]);
-		j = (j + 1) % POP_DIM;
-
-		for (int k = 1; k < POP_DIM; ++k) {
-			if (random_cr_() <= this->kCR_) {
-				pop_candidate_[j] = pop_trials_[0][j] + this->kF_ * (pop_trials_[1][j] - pop_trials_[2][j]);
-		    } else {
-		      	pop_candidate_[j] = population_[actual_index][j];
-		    }
-		    j = (j + 1) % POP_DIM;
-	    }
 	}
 	
 
 	void select(const uint32_t actual_index) {
+		double violation_new = 0;
+		if (constraints_) {
+			// The cheap check goes first, infeasible trials are
+			// compared by their violation only
+			violation_new = constraints_->callback_violation_(pop_candidate_);
+			if (!feasible(violation_new)) {
+				++infeasible_trials_;
+				if (violation_new < pop_violations_[actual_index]) {
+					population_[actual_index] = pop_candidate_;
+					pop_violations_[actual_index] = violation_new;
+				}
+				return;
+			}
+		}
+		// An infeasible target loses anyway, no need to screen
+		if (surrogate_ && feasible(pop_violations_[actual_index])
+			&& !surrogate_->promising(pop_candidate_,
+				pop_errors_[actual_index], this->callback_error_evaluation_)) {
+			++skipped_evaluations_;
+			return;
+		}
 		ERROR_TYPE error_new = this->callback_calc_error_(pop_candidate_);
+		++evaluations_;
+		if (surrogate_) {
+			surrogate_->add(pop_candidate_, error_new);
+		}
 
-		if (this->callback_error_evaluation_(error_new, pop_errors_[actual_index])) {
+		if (better(error_new, violation_new,
+				pop_errors_[actual_index], pop_violations_[actual_index])) {
 			for (int d = 0; d < POP_DIM; d++) {
 				population_[actual_index][d] = pop_candidate_[d];
 			}
 			pop_errors_[actual_index] = error_new;
+			pop_violations_[actual_index] = violation_new;
+		}
+	}
+
+	double violation(const std::array<POP_TYPE,POP_DIM>& x) const {
+		return constraints_ ? constraints_->callback_violation_(x) : 0;
+	}
+
+	// Within the epsilon level. The error of an infeasible entity
+	// is never calculated, nor read.
+	bool feasible(const double violation) const {
+		return !constraints_ || violation <= constraints_->epsilon(generation_);
+	}
+
+	// Deb's rules with constraints, the error evaluation otherwise
+	bool better(const ERROR_TYPE& error_a, const double violation_a,
+		const ERROR_TYPE& error_b, const double violation_b) const {
+		if (!constraints_) {
+			return this->callback_error_evaluation_(error_a, error_b);
 		}
+		return ConstraintHandler<POP_TYPE,POP_DIM>::better(error_a, violation_a,
+			error_b, violation_b, constraints_->epsilon(generation_),
+			this->callback_error_evaluation_);
+	}
+
+	bool better(const uint32_t a, const uint32_t b) const {
+		return better(pop_errors_[a], pop_violations_[a],
+			pop_errors_[b], pop_violations_[b]);
+	}
+
+	uint32_t bestIndex() const {
+		uint32_t best = 0;
+		for (uint32_t i = 1; i < population_.size(); ++i) {
+			if (better(i, best)) {
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	uint32_t worstIndex() const {
+		uint32_t worst = 0;
+		for (uint32_t i = 1; i < population_.size(); ++i) {
+			if (better(worst, i)) {
+				worst = i;
+			}
+		}
+		return worst;
 	}
 };
 
+template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
+constexpr uint32_t SequentialDE<POP_TYPE,POP_DIM,ERROR_TYPE>::kMinPopSize_;
+
+#ifdef PDEBC_EXTERN_TEMPLATES
+/// \cond DEV
+#define PDEBC_EXTERN_SEQUENTIALDE(POP_TYPE, POP_DIM, ERROR_TYPE) \
+	extern template struct SequentialDE<POP_TYPE,POP_DIM,ERROR_TYPE>;
+PDEBC_FOR_EACH_INSTANCE(PDEBC_EXTERN_SEQUENTIALDE)
+#undef PDEBC_EXTERN_SEQUENTIALDE
+/// \endcond
+#endif
+
 } // end namespace pdebc
 
 #endif /* SEQUENTIALDE_HPP_ */
@@ -0,0 +1,246 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#ifndef SOLVEHANDLE_HPP_
+#define SOLVEHANDLE_HPP_
+
+#include <array>
+#include <tuple>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include <cstdint>
+
+#include "BaseDE.hpp"
+
+namespace pdebc {
+
+//! A run of generations on a background thread.
+/*!
+	Created by solveAsync(). The caller polls the progress and the best
+	so far (a copy taken after each generation, so reading it never waits
+	for a generation), and can pause, resume or cancel the run. Pausing
+	and cancelling are checked between generations, so they take effect
+	when the current generation ends.
+
+	Meanwhile, the engine must not be used by anyone else.
+
+	\tparam SNAPSHOT Type of the best so far, as returned by the snapshot
+		function.
+*/
+template <class SNAPSHOT>
+struct SolveHandle {
+
+	const uint32_t kGenerations_; ///< Generations to run, unless cancelled.
+
+	//! Starts running the generations.
+	/*!
+		\param n_generations Generations to run.
+		\param step Runs one generation.
+		\param snapshot Returns the best so far. Called once here, by the
+			calling thread, then after each generation by the run's thread.
+	*/
+	SolveHandle(const uint32_t n_generations, std::function<void()>&& step,
+		std::function<SNAPSHOT()>&& snapshot) :
+			kGenerations_{n_generations}, step_{std::move(step)},
+			snapshot_{std::move(snapshot)}, best_{snapshot_()},
+			generations_{0}, paused_{false}, cancelled_{false}, done_{false},
+			start_{std::chrono::steady_clock::now()}, end_{start_} {
+
+		thread_ = std::thread(&SolveHandle::run, this);
+	}
+
+	//! Cancels the run, and waits for its current generation.
+	~SolveHandle() {
+		cancel();
+		thread_.join();
+	}
+
+	SolveHandle(const SolveHandle&) = delete;
+	SolveHandle& operator=(const SolveHandle&) = delete;
+
+	//! Best so far, as of the last finished generation.
+	SNAPSHOT getBest() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return best_;
+	}
+
+	//! Generations finished so far.
+	uint32_t getGenerations() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return generations_;
+	}
+
+	//! Seconds since the start, until the end of the run.
+	double getElapsed() const {
+		using namespace std::chrono;
+		std::lock_guard<std::mutex> lock(mutex_);
+		return duration<double>((done_ ? end_ : steady_clock::now())
+			- start_).count();
+	}
+
+	//! True once the run is over (finished, cancelled or failed).
+	bool isDone() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return done_;
+	}
+
+	//! True if cancel() was called.
+	bool isCancelled() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return cancelled_;
+	}
+
+	//! True between pause() and resume().
+	bool isPaused() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return paused_;
+	}
+
+	//! Stops before the next generation, until resume().
+	void pause() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		paused_ = true;
+	}
+
+	//! Lets a paused run go on.
+	void resume() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		paused_ = false;
+		cond_.notify_all();
+	}
+
+	//! Ends the run before the next generation. Doesn't wait for it.
+	void cancel() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		cancelled_ = true;
+		cond_.notify_all();
+	}
+
+	//! Waits for the end of the run.
+	/*!
+		Rethrows the exception of a failed generation, if any.
+	*/
+	void wait() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		cond_.wait(lock, [this]() {return this->done_;});
+		rethrow();
+	}
+
+	//! Waits for the end of the run, for `seconds` at most.
+	/*!
+		\return True if the run is over. See wait().
+	*/
+	bool waitFor(const double seconds) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (!cond_.wait_for(lock, std::chrono::duration<double>(seconds),
+				[this]() {return this->done_;})) {
+			return false;
+		}
+		rethrow();
+		return true;
+	}
+
+private:
+	const std::function<void()> step_;
+	const std::function<SNAPSHOT()> snapshot_;
+	SNAPSHOT best_;
+	uint32_t generations_;
+	bool paused_;
+	bool cancelled_;
+	bool done_;
+	std::exception_ptr error_;
+	std::chrono::steady_clock::time_point start_;
+	std::chrono::steady_clock::time_point end_;
+	mutable std::mutex mutex_;
+	std::condition_variable cond_;
+	std::thread thread_;
+
+	void run() {
+		using namespace std;
+		try {
+			for (uint32_t g = 0; g < kGenerations_; ++g) {
+				{
+					unique_lock<mutex> lock(mutex_);
+					cond_.wait(lock, [this]() {
+						return !this->paused_ || this->cancelled_;
+					});
+					if (cancelled_) {
+						break;
+					}
+				}
+				step_();
+				SNAPSHOT best = snapshot_();
+				lock_guard<mutex> lock(mutex_);
+				best_ = std::move(best);
+				++generations_;
+			}
+		} catch (...) {
+			lock_guard<mutex> lock(mutex_);
+			error_ = current_exception();
+		}
+		lock_guard<mutex> lock(mutex_);
+		done_ = true;
+		end_ = chrono::steady_clock::now();
+		cond_.notify_all();
+	}
+
+	// Called with mutex_ locked
+	void rethrow() {
+		if (error_) {
+			std::rethrow_exception(error_);
+		}
+	}
+};
+
+//! Runs `n_generations` generations of `de` on a background thread.
+/*!
+	The best so far is `de.getBestCandidate()`, taken after each
+	generation. For a deadline:
+
+	\code
+	auto handle = pdebc::solveAsync(de, 100000);
+	handle->waitFor(0.5);
+	handle->cancel();
+	auto best = handle->getBest();
+	\endcode
+
+	The run is cancelled when the handle is destroyed, so keep `de` alive
+	until then.
+*/
+template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
+std::shared_ptr<SolveHandle<std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>>>>
+solveAsync(BaseDE<POP_TYPE,POP_DIM,ERROR_TYPE>& de, const uint32_t n_generations) {
+	using Best = std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>>;
+	auto* engine = &de;
+	return std::make_shared<SolveHandle<Best>>(n_generations,
+		[engine]() {
+			engine->solveOneGeneration();
+		},
+		[engine]() {
+			return engine->getBestCandidate();
+		});
+}
+
+} // end namespace pdebc
+
+#endif /* SOLVEHANDLE_HPP_ */
@@ -0,0 +1,318 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef SURROGATE_HPP_
+#define SURROGATE_HPP_
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <limits>
+
+namespace pdebc {
+
+//! k nearest neighbours model of the error function.
+/*!
+	Keeps an archive of every evaluated entity in a k-d tree, and predicts
+	the error of a new entity as the inverse squared distance weighted mean of its
+	`k` nearest neighbours.
+
+	The engines use it to pre-screen trials (see SequentialDE::setSurrogate()
+	and ThreadsDE::setSurrogate()): a trial whose predicted error doesn't
+	beat its target is discarded without calling the error function, unless
+	it's picked for exploration. The model is only a filter, entities and
+	their errors in the population always come from the real function.
+
+	Points are inserted in the tree as they come, and the tree is rebuilt
+	balanced every time the archive doubles, so both insertion and
+	prediction stay about O(log N). An entity already in the archive only
+	updates its error, and once the archive grows a quarter past
+	`max_archive` the oldest entities are dropped, so the model follows
+	the region the population is in and its memory stays bounded.
+
+	\tparam POP_TYPE Population data type (usually 'double')
+	\tparam POP_DIM Population dimensions (usually 2D or 3D)
+	\tparam ERROR_TYPE Error type, it must convert to and from double.
+*/
+template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
+struct KNNSurrogate {
+
+	static const uint32_t kMaxNeighbours_ = 32; ///< Most neighbours a prediction can use.
+
+	const uint32_t kNeighbours_; ///< Neighbours used by each prediction.
+	const double kExploration_; ///< Chances of evaluating a trial that doesn't look promising.
+	const uint32_t kMinArchive_; ///< Archive size needed before any trial is discarded.
+	const uint32_t kMaxArchive_; ///< Most recent entities kept in the archive.
+
+	/*!
+		\param neighbours Neighbours used by each prediction, between
+			[1,kMaxNeighbours_].
+		\param exploration Chances of evaluating a trial even if it doesn't
+			look promising, between [0,1]. Keeps the model honest in regions
+			it knows badly.
+		\param min_archive Archive size needed before discarding trials.
+		\param max_archive Most recent entities kept in the archive, never
+			less than `min_archive`.
+	*/
+	KNNSurrogate(const uint32_t neighbours = 8, const double exploration = 0.1,
+		const uint32_t min_archive = 64, const uint32_t max_archive = 16384) :
+			kNeighbours_{neighbours < 1 ? 1
+				: neighbours > kMaxNeighbours_ ? kMaxNeighbours_ : neighbours},
+			kExploration_{exploration},
+			kMinArchive_{std::max(min_archive, std::max<uint32_t>(1, neighbours))},
+			kMaxArchive_{std::max(max_archive, kMinArchive_)},
+			emt_{std::random_device{}()} {
+
+	}
+
+	//! Adds an evaluated entity to the archive.
+	/*!
+		If `x` is already in the archive only its error is updated.
+	*/
+	void add(const std::array<POP_TYPE,POP_DIM>& x, const ERROR_TYPE& error) {
+		const int node = find(root_, x);
+		if (node >= 0) {
+			errors_[nodes_[node].point] = static_cast<double>(error);
+			return;
+		}
+		points_.push_back(x);
+		errors_.push_back(static_cast<double>(error));
+		if (points_.size() >= kMaxArchive_ + kMaxArchive_ / 4 + 1) {
+			// Only the most recent kMaxArchive_ are kept
+			const std::size_t drop = points_.size() - kMaxArchive_;
+			points_.erase(points_.begin(), points_.begin() + drop);
+			errors_.erase(errors_.begin(), errors_.begin() + drop);
+			rebuild();
+		} else if (points_.size() >= 2 * built_size_) {
+			rebuild();
+		} else {
+			insert(points_.size() - 1);
+		}
+	}
+
+	//! Number of entities in the archive.
+	uint32_t size() const {
+		return points_.size();
+	}
+
+	//! Predicted error of `x`.
+	/*!
+		\return false if the archive is still empty.
+	*/
+	bool predict(const std::array<POP_TYPE,POP_DIM>& x, ERROR_TYPE& out) const {
+		if (points_.empty()) {
+			return false;
+		}
+		Nearest nearest{kNeighbours_};
+		search(root_, x, nearest);
+
+		double sum = 0;
+		double weights = 0;
+		for (uint32_t i = 0; i < nearest.size_; ++i) {
+			if (nearest.d2_[i] == 0) {
+				out = static_cast<ERROR_TYPE>(errors_[nearest.point_[i]]);
+				return true;
+			}
+			const double w = 1 / nearest.d2_[i];
+			sum += w * errors_[nearest.point_[i]];
+			weights += w;
+		}
+		out = static_cast<ERROR_TYPE>(sum / weights);
+		return true;
+	}
+
+	//! Should `trial` be evaluated?
+	/*!
+		\param trial Trial entity.
+		\param target_error Error of the entity it competes with.
+		\param error_evaluation Error comparison, true if the first is better.
+		\return true if the trial is predicted to win, if it's picked for
+			exploration, or if the archive is still too small.
+	*/
+	template <class COMPARE>
+	bool promising(const std::array<POP_TYPE,POP_DIM>& trial,
+		const ERROR_TYPE& target_error, const COMPARE& error_evaluation) {
+		ERROR_TYPE predicted;
+		if (points_.size() < kMinArchive_ || !predict(trial, predicted)) {
+			return true;
+		}
+		if (error_evaluation(predicted, target_error)) {
+			return true;
+		}
+		return std::uniform_real_distribution<double>(0.0, 1.0)(emt_)
+			< kExploration_;
+	}
+
+private:
+	struct Node {
+		uint32_t point;
+		int left;
+		int right;
+		int dim;
+	};
+
+	// The k nearest so far, sorted by distance. On the stack, k is small.
+	struct Nearest {
+		const uint32_t kK_;
+		uint32_t size_{0};
+		std::array<double,kMaxNeighbours_> d2_;
+		std::array<uint32_t,kMaxNeighbours_> point_;
+
+		explicit Nearest(const uint32_t k) : kK_{k} {
+
+		}
+
+		bool full() const {
+			return size_ == kK_;
+		}
+
+		// Squared distance of the farthest one kept
+		double worst() const {
+			return d2_[size_ - 1];
+		}
+
+		void add(const double d2, const uint32_t point) {
+			if (full() && !(d2 < worst())) {
+				return;
+			}
+			uint32_t i = full() ? size_ - 1 : size_++;
+			for (; i > 0 && d2 < d2_[i - 1]; --i) {
+				d2_[i] = d2_[i - 1];
+				point_[i] = point_[i - 1];
+			}
+			d2_[i] = d2;
+			point_[i] = point;
+		}
+	};
+
+	std::vector<std::array<POP_TYPE,POP_DIM>> points_;
+	std::vector<double> errors_;
+	std::vector<Node> nodes_;
+	int root_{-1};
+	std::size_t built_size_{0};
+	std::mt19937 emt_;
+
+	static double distance2(const std::array<POP_TYPE,POP_DIM>& a,
+		const std::array<POP_TYPE,POP_DIM>& b) {
+		double d2 = 0;
+		for (int d = 0; d < POP_DIM; ++d) {
+			const double diff = static_cast<double>(a[d]) - b[d];
+			d2 += diff * diff;
+		}
+		return d2;
+	}
+
+	// Balanced tree of every point, median splits
+	void rebuild() {
+		std::vector<uint32_t> order(points_.size());
+		for (uint32_t i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+		nodes_.clear();
+		nodes_.reserve(points_.size());
+		root_ = build(order, 0, order.size(), 0);
+		built_size_ = points_.size();
+	}
+
+	int build(std::vector<uint32_t>& order, const std::size_t first,
+		const std::size_t last, const int depth) {
+		if (first >= last) {
+			return -1;
+		}
+		const int dim = depth % POP_DIM;
+		const std::size_t mid = first + (last - first) / 2;
+		std::nth_element(order.begin() + first, order.begin() + mid,
+			order.begin() + last, [this,dim](const uint32_t a, const uint32_t b) {
+				return this->points_[a][dim] < this->points_[b][dim];
+			});
+		const int n = nodes_.size();
+		nodes_.push_back(Node{order[mid], -1, -1, dim});
+		const int left = build(order, first, mid, depth + 1);
+		const int right = build(order, mid + 1, last, depth + 1);
+		nodes_[n].left = left;
+		nodes_[n].right = right;
+		return n;
+	}
+
+	void insert(const uint32_t point) {
+		const auto& x = points_[point];
+		const int node = nodes_.size();
+		int parent = -1;
+		bool left = false;
+		int depth = 0;
+		for (int n = root_; n >= 0; ++depth) {
+			parent = n;
+			left = x[nodes_[n].dim] < points_[nodes_[n].point][nodes_[n].dim];
+			n = left ? nodes_[n].left : nodes_[n].right;
+		}
+		nodes_.push_back(Node{point, -1, -1, depth % POP_DIM});
+		if (parent < 0) {
+			root_ = node;
+		} else if (left) {
+			nodes_[parent].left = node;
+		} else {
+			nodes_[parent].right = node;
+		}
+	}
+
+	// Node of a point equal to `x`, or -1. Points equal to a split can be
+	// on either side after a rebuild, so both are searched on a tie.
+	int find(const int node, const std::array<POP_TYPE,POP_DIM>& x) const {
+		for (int n = node; n >= 0; ) {
+			const auto& p = points_[nodes_[n].point];
+			const int dim = nodes_[n].dim;
+			if (x[dim] < p[dim]) {
+				n = nodes_[n].left;
+			} else if (p[dim] < x[dim]) {
+				n = nodes_[n].right;
+			} else if (x == p) {
+				return n;
+			} else {
+				const int left = find(nodes_[n].left, x);
+				if (left >= 0) {
+					return left;
+				}
+				n = nodes_[n].right;
+			}
+		}
+		return -1;
+	}
+
+	void search(const int node, const std::array<POP_TYPE,POP_DIM>& x,
+		Nearest& nearest) const {
+		// Nothing can be nearer than k coincident neighbours
+		if (node < 0 || (nearest.full() && nearest.worst() == 0)) {
+			return;
+		}
+		const Node& n = nodes_[node];
+		nearest.add(distance2(x, points_[n.point]), n.point);
+
+		const double diff = static_cast<double>(x[n.dim]) - points_[n.point][n.dim];
+		const int near = diff < 0 ? n.left : n.right;
+		const int far = diff < 0 ? n.right : n.left;
+		search(near, x, nearest);
+		if (!nearest.full() || diff * diff < nearest.worst()) {
+			search(far, x, nearest);
+		}
+	}
+};
+
+} // end namespace pdebc
+
+#endif /* SURROGATE_HPP_ */
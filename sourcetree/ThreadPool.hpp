@@ -0,0 +1,166 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+#ifndef THREADPOOL_HPP_
+#define THREADPOOL_HPP_
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <exception>
+
+/// \cond DEV
+namespace pdebc {
+
+//! Fixed set of threads running parallel for loops.
+/*!
+	The calling thread also works, so a pool of size N starts N-1 threads.
+*/
+struct ThreadPool {
+
+	const uint32_t kNThreads_;
+
+	explicit ThreadPool(const uint32_t n_threads) :
+		kNThreads_{std::max<uint32_t>(1, n_threads)},
+		work_{nullptr}, n_{0}, chunk_size_{1}, next_{0},
+		round_{0}, busy_{0}, finish_{false} {
+
+		for (uint32_t t = 1; t < kNThreads_; ++t) {
+			threads_.push_back(std::thread(&ThreadPool::run, this));
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			finish_ = true;
+		}
+		cond_.notify_all();
+		for (auto& t : threads_) {
+			t.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	//! Calls `work(begin, end)` for every chunk of [0,n).
+	/*!
+		Chunks have `chunk_size` indexes (the last one may be smaller) and
+		are taken by the threads as they get free. This is a blocking method,
+		and it must not be called by two threads at once.
+
+		If `work` throws, the chunks not started yet are skipped, and the
+		first exception is rethrown once every thread is done.
+	*/
+	void parallelFor(const uint32_t n, uint32_t chunk_size,
+		const std::function<void(uint32_t,uint32_t)>& work) {
+		chunk_size = std::max<uint32_t>(1, chunk_size);
+		if (kNThreads_ == 1 || n <= chunk_size) {
+			for (uint32_t b = 0; b < n; b += chunk_size) {
+				work(b, std::min(n, b + chunk_size));
+			}
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			work_ = &work;
+			n_ = n;
+			chunk_size_ = chunk_size;
+			next_ = 0;
+			error_ = nullptr;
+			busy_ = kNThreads_ - 1;
+			++round_;
+		}
+		cond_.notify_all();
+		runChunks();
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		done_cond_.wait(lock, [this]() {return this->busy_ == 0;});
+		work_ = nullptr;
+		if (error_) {
+			std::exception_ptr error = error_;
+			error_ = nullptr;
+			std::rethrow_exception(error);
+		}
+	}
+
+private:
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	std::condition_variable done_cond_;
+
+	const std::function<void(uint32_t,uint32_t)>* work_;
+	uint32_t n_;
+	uint32_t chunk_size_;
+	std::atomic<uint32_t> next_;
+	uint64_t round_;
+	uint32_t busy_;
+	bool finish_;
+	std::exception_ptr error_; // First one thrown by work_ this round
+
+	void runChunks() {
+		for (;;) {
+			const uint32_t b = next_.fetch_add(chunk_size_);
+			if (b >= n_) {
+				return;
+			}
+			try {
+				(*work_)(b, std::min(n_, b + chunk_size_));
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (!error_) {
+					error_ = std::current_exception();
+				}
+				next_ = n_; // Skips the chunks left
+			}
+		}
+	}
+
+	void run() {
+		uint64_t seen = 0;
+		for (;;) {
+			std::unique_lock<std::mutex> lock(mutex_);
+			cond_.wait(lock, [this,seen]() {
+				return this->finish_ || this->round_ != seen;
+			});
+			if (finish_) {
+				return;
+			}
+			seen = round_;
+			lock.unlock();
+
+			runChunks();
+
+			lock.lock();
+			if (--busy_ == 0) {
+				done_cond_.notify_one();
+			}
+		}
+	}
+};
+
+} // end namespace pdebc
+/// \endcond
+
+#endif /* THREADPOOL_HPP_ */
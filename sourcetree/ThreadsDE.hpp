@@ -22,9 +22,15 @@
 #include <tuple>
 #include <algorithm>
 #include <chrono>
+#include <random>
+#include <vector>
 
 #include "BaseDE.hpp"
 #include "ThreadsDESolver.hpp"
+#include "PopulationReduction.hpp"
+#include "Restart.hpp"
+#include "LocalSearch.hpp"
+#include "Trace.hpp"
 
 namespace pdebc {
 
@@ -39,7 +45,7 @@ struct ThreadsDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 
 	const uint32_t kNProcess_; ///< Number of threads.
 	const double kMigrationPhi_; ///< Chances of migration.
-	const uint32_t kPopSize_; ///< Population size.
+	const uint32_t kPopSize_; ///< Initial population size.
 
 	/*!
 		\param n_process Number of threads to use.
@@ -47,9 +53,9 @@ struct ThreadsDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 			of a population entity moving to the population of another thread.
 			This values should be between [0,1].
 
-		\param POP_SIZE Population size. Note that each thread will keep
-			( ThreadsDE::kPopSize_ / ThreadsDE::kNProcess_ ) entities locally. So, it is
-			advisable to pass a number divisible by ThreadsDE::kNProcess_.
+		\param POP_SIZE Population size. Each thread keeps about
+			( ThreadsDE::kPopSize_ / ThreadsDE::kNProcess_ ) entities locally,
+			the remainder goes to the first threads.
 
 		\param CR Mutation rate. Determines the chances
 			of a mutation happening. This value must be 
@@ -66,12 +72,16 @@ struct ThreadsDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE. It
 			must return a bool. In case of true, the population from the first ERROR_TYPE
 			will be picked as best candidate. Try to figure out what happens in case of false xD.
+		\param cpu_affinity Optional CPU of each thread (thread `k` uses
+			`cpu_affinity[k % size]`). Each thread allocates its own population,
+			so it stays in the NUMA node of its CPU. See getNUMAAffinity().
 	*/
 	ThreadsDE(const uint32_t n_process, const double migration_phi,
 		const uint32_t POP_SIZE, const double CR, const double F,
 		const std::function<POP_TYPE()>&& callback_population_generator,
 		const std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_error,
-		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation) :
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation,
+		const std::vector<int>& cpu_affinity = std::vector<int>()) :
 			kNProcess_{n_process}, kMigrationPhi_{migration_phi},kPopSize_{POP_SIZE},
 			BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE>(
 				CR, F,
@@ -79,23 +89,38 @@ struct ThreadsDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 				std::move(callback_calc_error),
 				std::move(callback_error_evaluation)) {
 
-		// Initialize random functions for the
-		// migration step...
-		using namespace std;
-		mt19937 emt(random_device{}());
-		uniform_real_distribution<double> ud(0.0, 1.0);
-		random_phi_ = bind(ud, emt);
+		initialize(cpu_affinity);
+	}
 
-		mt19937 emt2(random_device{}());
-		uniform_int_distribution<uint32_t> ui2(0, (kPopSize_/kNProcess_)-1);
-		random_migration_index_ = bind(ui2, emt2);
+	/*!
+		\param n_process Number of threads to use.
+		\param migration_phi Chances of migration.
+		\param POP_SIZE Population size.
+		\param CR Mutation rate.
+		\param F Mutation weight.
+		\param population_initializer Generates the entire initial population
+			inside its bounds (Latin hypercube, Halton, opposition based...).
+			The plan covers the whole population, then each thread gets a slice
+			of it. See PopulationInitializer.
+		\param callback_calc_error Function used to calculate the error with a single
+			member of the population.
+		\param callback_error_evaluation Fuction used to compare two ERROR_TYPE.
+		\param cpu_affinity Optional CPU of each thread. See getNUMAAffinity().
+	*/
+	ThreadsDE(const uint32_t n_process, const double migration_phi,
+		const uint32_t POP_SIZE, const double CR, const double F,
+		const PopulationInitializer<POP_TYPE,POP_DIM>& population_initializer,
+		const std::function<ERROR_TYPE(const std::array<POP_TYPE,POP_DIM>&)>&& callback_calc_error,
+		const std::function<bool(const ERROR_TYPE&,const ERROR_TYPE&)>&& callback_error_evaluation,
+		const std::vector<int>& cpu_affinity = std::vector<int>()) :
+			kNProcess_{n_process}, kMigrationPhi_{migration_phi},kPopSize_{POP_SIZE},
+			BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE>(
+				CR, F,
+				population_initializer,
+				std::move(callback_calc_error),
+				std::move(callback_error_evaluation)) {
 
-		// Initialize each solver...
-  		using MyThreadsDESolver = pdebc::ThreadsDESolver<POP_TYPE,POP_DIM,ERROR_TYPE>;
-		for (int k = 0; k < kNProcess_; k++) {
-			auto solver = shared_ptr<MyThreadsDESolver>(new MyThreadsDESolver(k,kPopSize_/kNProcess_,this));
-			solvers_.push_back(solver);
-		}
+		initialize(cpu_affinity);
 	}
 
 	~ThreadsDE() {
@@ -107,13 +132,214 @@ struct ThreadsDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 		This is a blocking operation.
 	*/
 	void solveOneGeneration() {
+		PDEBC_TRACE_SCOPE("generation");
 		for (auto& s : solvers_) {
 			s->solveOneGeneration();
 		}
-		for (auto& s : solvers_) {
-			s->waitWork();
+		{
+			PDEBC_TRACE_SCOPE("wait islands");
+			for (auto& s : solvers_) {
+				s->waitWork();
+				evaluations_ += s->getGenerationEvaluations();
+			}
+		}
+		++generation_;
+		if (load_balancing_) {
+			balanceLoad();
+		}
+		if (population_schedule_) {
+			reducePopulation();
 		}
 		migration();
+		if (restart_policy_) {
+			checkStagnation();
+		}
+		if (local_search_) {
+			polish();
+		}
+	}
+
+	//! Polishes the best entity with a local search, next to the islands.
+	/*!
+		Every `period` generations (once the previous search is done), a
+		Nelder-Mead search starts from the best entity on a spare thread,
+		while the islands go on. Its initial simplex is half of the spread
+		of the best entity's island. When it ends, its result replaces the
+		worst entity of the island that has the best one, if it beats it.
+		Its evaluations are added to getEvaluations().
+
+		\param period Generations between the searches.
+		\param max_evaluations Evaluation budget of each search.
+	*/
+	void setLocalSearch(const uint32_t period,
+		const uint32_t max_evaluations = 200 * POP_DIM) {
+		local_search_ = std::make_shared<LocalSearchRunner<POP_TYPE,POP_DIM,ERROR_TYPE>>(
+			period, max_evaluations);
+	}
+
+	//! Restarts the islands when they stagnate.
+	/*!
+		The islands are split in groups of `group_size` consecutive islands.
+		Each group tracks its own stagnation and restarts on its own, so
+		several restarts may run at once, each one on the threads of its
+		group. Migration and load balancing only happen inside a group.
+
+		A restart reuses the solvers' threads and buffers: a new population is
+		sampled for each island of the group (IPOP: larger and random, LOCAL:
+		around the group's best entity) and evaluated by the island's thread.
+		The best entity ever found is kept by getBestCandidate().
+		See RestartPolicy.
+
+		\param policy When and how to restart.
+		\param group_size Islands per group, by default all of them.
+	*/
+	void setRestartPolicy(const RestartPolicy& policy, const uint32_t group_size = 0) {
+		using namespace std;
+		// Before restart_policy_ is set, so the (empty) elite isn't used
+		auto best = getBestCandidate();
+		elite_ = best;
+		restart_policy_ = make_shared<RestartPolicy>(policy);
+		const uint32_t P = solvers_.size();
+		const uint32_t G = group_size == 0 ? P : min(P, group_size);
+		groups_.clear();
+		for (uint32_t first = 0; first < P; first += G) {
+			RestartGroup g;
+			g.first = first;
+			g.last = min(P, first + G);
+			g.best = best;
+			g.stagnant_generations = 0;
+			g.restarts = 0;
+			groups_.push_back(g);
+		}
+	}
+
+	//! Number of restarts of each group.
+	std::vector<uint32_t> getRestarts() const {
+		std::vector<uint32_t> restarts;
+		for (auto& g : groups_) {
+			restarts.push_back(g.restarts);
+		}
+		return restarts;
+	}
+
+	//! Shrinks the population along the run.
+	/*!
+		After each generation, the population size is set to
+		`schedule(evaluations)`. Each island evicts its own worst entities,
+		keeping its share of the population (and at least 4 entities).
+		See linearPopulationReduction().
+	*/
+	void setPopulationReduction(const PopulationSchedule& schedule) {
+		population_schedule_ = schedule;
+	}
+
+	//! Current population size, the sum of every island.
+	uint32_t getPopSize() const {
+		uint32_t n = 0;
+		for (auto& s : solvers_) {
+			n += s->getPopSize();
+		}
+		return n;
+	}
+
+	//! Number of evaluations done so far, the initial population included.
+	uint64_t getEvaluations() const {
+		return evaluations_;
+	}
+
+	//! Pre-screens the trials with a model of the error function.
+	/*!
+		Each island gets its own copy of `surrogate`, trained on its local
+		population and evaluations, so no locking is needed. Trials predicted
+		to lose against their target are discarded without being evaluated
+		(see KNNSurrogate::promising()).
+	*/
+	void setSurrogate(const KNNSurrogate<POP_TYPE,POP_DIM,ERROR_TYPE>& surrogate) {
+		for (auto& s : solvers_) {
+			s->setSurrogate(surrogate);
+		}
+	}
+
+	//! Number of trials discarded by the surrogates.
+	uint64_t getSkippedEvaluations() const {
+		uint64_t n = 0;
+		for (auto& s : solvers_) {
+			n += s->getSkippedEvaluations();
+		}
+		return n;
+	}
+
+	//! Checks the constraints of every trial before its error.
+	/*!
+		Trials violating the constraints (by more than the epsilon level)
+		are compared with their target by the violation only, without
+		calling the error function. Every comparison, migration and best
+		candidate included, follows Deb's rules. The violation callback is
+		called by every thread, so it must be thread safe.
+		See ConstraintHandler.
+	*/
+	void setConstraints(const ConstraintHandler<POP_TYPE,POP_DIM>& constraints) {
+		constraints_ = std::make_shared<const ConstraintHandler<POP_TYPE,POP_DIM>>(
+			constraints);
+		for (auto& s : solvers_) {
+			s->setConstraints(constraints_);
+		}
+	}
+
+	//! Makes some dimensions integer or categorical.
+	/*!
+		Every trial is repaired after the crossover (see VariableTypes),
+		and so are the restarted populations and the local search vertices.
+		Each island repairs its population at the start of its next
+		generation, and evaluates again the entities it changes.
+	*/
+	void setVariableTypes(const VariableTypes<POP_DIM>& types) {
+		static_assert(std::is_floating_point<POP_TYPE>::value,
+			"VariableTypes needs a floating point POP_TYPE");
+		variable_types_ = std::make_shared<const VariableTypes<POP_DIM>>(types);
+		for (auto& s : solvers_) {
+			s->setVariableTypes(variable_types_);
+		}
+	}
+
+	//! Number of trials rejected by the constraints, without an evaluation.
+	uint64_t getInfeasibleTrials() const {
+		uint64_t n = 0;
+		for (auto& s : solvers_) {
+			n += s->getInfeasibleTrials();
+		}
+		return n;
+	}
+
+	//! Resizes the islands so every thread takes about the same time per generation.
+	/*!
+		Useful when the cost of the error function varies across the search
+		space. After each generation the time per entity of every thread is
+		measured (exponential moving average), and entities are moved from the
+		slow islands to the fast ones so the sizes are inversely proportional
+		to that cost. The population size stays the same and no entity is
+		lost, they only change island. With restart groups (see
+		setRestartPolicy()) entities only move inside their group.
+
+		\param smoothing Weight of the last generation in the moving average,
+			between (0,1]. Lower values react slower but ignore noise.
+	*/
+	void enableLoadBalancing(const double smoothing = 0.5) {
+		load_balancing_ = true;
+		smoothing_ = smoothing;
+	}
+
+	void disableLoadBalancing() {
+		load_balancing_ = false;
+	}
+
+	//! Number of entities of each island.
+	std::vector<uint32_t> getIslandSizes() const {
+		std::vector<uint32_t> sizes;
+		for (auto& s : solvers_) {
+			sizes.push_back(s->getPopSize());
+		}
+		return sizes;
 	}
 
 	void solveNGenerations(const uint32_t N) {
@@ -125,6 +351,10 @@ struct ThreadsDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 	/*!
 		This operation has an O(N) complexity, where N is the population size, but
 		the work will be divided by ThreadsDE::kNProcess_ threads.
+
+		With constraints, the best entity follows Deb's rules (see
+		ConstraintHandler). While no entity is feasible, the returned error
+		is not meaningful.
 	*/
 	std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>> getBestCandidate() {
 		using namespace std;
@@ -133,45 +363,436 @@ struct ThreadsDE : public BaseDE<POP_TYPE, POP_DIM, ERROR_TYPE> {
 			s->solveBestCandidate();
 		}
 		solvers_[0]->waitWork();
-		double min_error = get<0>(solvers_[0]->getBestCandidate());
-		array<POP_TYPE,POP_DIM> min_error_pos = get<1>(solvers_[0]->getBestCandidate());;
+		auto best = solvers_[0]->getBestCandidate();
 		
 		for (auto& s : solvers_) {
 			s->waitWork();
 			auto bc = s->getBestCandidate();
-			if (get<0>(bc) < min_error) {
-				min_error = get<0>(bc);
-				min_error_pos = get<1>(bc);
+			if (better(bc, best)) {
+				best = bc;
 			}
 		}
+		if (restart_policy_ && better(elite_, best)) {
+			return elite_;
+		}
 
-		return std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>>{min_error,min_error_pos};
+		return best;
 	}
 
 private:
+	// Smallest island allowed by the load balancing, DE needs 3
+	// entities besides the one being mutated
+	static constexpr uint32_t kMinIslandSize_ = 4;
+	// Only rebalance if the slowest island gets this much faster
+	static constexpr double kMinBalanceGain_ = 0.05;
+
 	std::function<double()> random_phi_;
-	std::function<uint32_t()> random_migration_index_;
+	std::mt19937 emt_;
 	std::vector<std::shared_ptr<ThreadsDESolver<POP_TYPE,POP_DIM,ERROR_TYPE>>> solvers_;
 
+	bool load_balancing_{false};
+	double smoothing_{0.5};
+	std::vector<double> entity_cost_; // Seconds per entity of each island
+
+	PopulationSchedule population_schedule_;
+	uint64_t evaluations_{0};
+
+	// Islands [first,last) restart together
+	struct RestartGroup {
+		uint32_t first;
+		uint32_t last;
+		std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>> best;
+		uint32_t stagnant_generations;
+		uint32_t restarts;
+	};
+	std::shared_ptr<RestartPolicy> restart_policy_;
+	std::vector<RestartGroup> groups_;
+	std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>> elite_;
+
+	std::shared_ptr<LocalSearchRunner<POP_TYPE,POP_DIM,ERROR_TYPE>> local_search_;
+
+	std::shared_ptr<const ConstraintHandler<POP_TYPE,POP_DIM>> constraints_;
+	std::shared_ptr<const VariableTypes<POP_DIM>> variable_types_;
+	uint64_t generation_{0}; // Same epsilon level as the solvers
+
+	// Deb's rules with constraints, the error evaluation otherwise. The
+	// violations are calculated again, they are cheap.
+	bool better(const std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>>& a,
+		const std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>>& b) const {
+		if (!constraints_) {
+			return this->callback_error_evaluation_(std::get<0>(a), std::get<0>(b));
+		}
+		return ConstraintHandler<POP_TYPE,POP_DIM>::better(
+			std::get<0>(a), constraints_->callback_violation_(std::get<1>(a)),
+			std::get<0>(b), constraints_->callback_violation_(std::get<1>(b)),
+			constraints_->epsilon(generation_), this->callback_error_evaluation_);
+	}
+
+	bool feasible(const std::array<POP_TYPE,POP_DIM>& x) const {
+		return !constraints_ || constraints_->callback_violation_(x)
+			<= constraints_->epsilon(generation_);
+	}
+
+	uint32_t randomIndex(const uint32_t n) {
+		return std::uniform_int_distribution<uint32_t>(0, n-1)(emt_);
+	}
+
+	void initialize(const std::vector<int>& cpu_affinity) {
+		// Initialize random functions for the
+		// migration step...
+		using namespace std;
+		mt19937 emt(random_device{}());
+		uniform_real_distribution<double> ud(0.0, 1.0);
+		random_phi_ = bind(ud, emt);
+
+		emt_.seed(random_device{}());
+		entity_cost_.assign(kNProcess_, 0);
+		evaluations_ = kPopSize_;
+		if (this->population_initializer_
+			&& this->population_initializer_->kOpposition_) {
+			evaluations_ += kPopSize_;
+		}
+
+		// The sampling plan of the initializer must cover the entire
+		// population, so it's generated here and split between solvers.
+		// Each solver still evaluates its own slice.
+		vector<array<POP_TYPE,POP_DIM>> plan;
+		if (this->population_initializer_) {
+			plan.resize(kPopSize_);
+			this->population_initializer_->generate(plan);
+		}
+
+		// Initialize each solver...
+  		using MyThreadsDESolver = pdebc::ThreadsDESolver<POP_TYPE,POP_DIM,ERROR_TYPE>;
+		uint32_t first = 0;
+		for (int k = 0; k < kNProcess_; k++) {
+			const uint32_t island_size = kPopSize_/kNProcess_
+				+ (static_cast<uint32_t>(k) < kPopSize_%kNProcess_ ? 1 : 0);
+			vector<array<POP_TYPE,POP_DIM>> initial_population;
+			if (!plan.empty()) {
+				initial_population.assign(plan.begin() + first,
+					plan.begin() + first + island_size);
+			}
+			first += island_size;
+			const int cpu = cpu_affinity.empty() ? -1
+				: cpu_affinity[k % cpu_affinity.size()];
+			auto solver = shared_ptr<MyThreadsDESolver>(new MyThreadsDESolver(
+				k,island_size,this,std::move(initial_population),cpu));
+			solvers_.push_back(solver);
+		}
+	}
+
 	// new step for the parallel solution ;)
 	void migration() {
 		using namespace std;
+		PDEBC_TRACE_SCOPE("migration");
 
 		for (auto& s : solvers_) {
 			s->solveBestCandidate();
 		}
+		// Every solver must be idle before one of them is written
+		for (auto& s : solvers_) {
+			s->waitWork();
+		}
 
 		for (int i = 0; i < solvers_.size(); ++i) {
 			if (random_phi_() < kMigrationPhi_) {
-				solvers_[i]->waitWork();
-				auto bc = get<1>(solvers_[i]->getBestCandidate());
-				const uint32_t mi = random_migration_index_();
-				solvers_[(i+1)%solvers_.size()]->population_[mi] = bc;
+				auto bc = solvers_[i]->getBestCandidate();
+				auto& target = solvers_[nextIsland(i)];
+				const uint32_t mi = randomIndex(target->getPopSize());
+				target->setIndividual(mi, get<1>(bc), get<0>(bc));
+			}
+		}
+	}
+
+	// Called after migration(), so every solver knows its best candidate
+	void polish() {
+		using namespace std;
+		auto cmp = this->callback_error_evaluation_;
+		uint32_t best = 0;
+		for (uint32_t k = 1; k < solvers_.size(); ++k) {
+			if (better(solvers_[k]->getBestCandidate(),
+					solvers_[best]->getBestCandidate())) {
+				best = k;
+			}
+		}
+		auto bc = solvers_[best]->getBestCandidate();
+
+		tuple<ERROR_TYPE,array<POP_TYPE,POP_DIM>,uint32_t> r;
+		if (local_search_->poll(r)) {
+			evaluations_ += get<2>(r);
+			if (better(make_tuple(get<0>(r), get<1>(r)), bc)) {
+				solvers_[best]->replaceWorst(get<1>(r), get<0>(r));
+			}
+		}
+		// The search needs the error of its starting point
+		if (local_search_->tick() && feasible(get<1>(bc))) {
+			local_search_->start(this->callback_calc_error_, cmp,
+				get<1>(bc), get<0>(bc),
+				LocalSearchRunner<POP_TYPE,POP_DIM,ERROR_TYPE>::steps(
+					solvers_[best]->population_),
+				constraints_, constraints_ ? constraints_->epsilon(generation_) : 0,
+				variable_types_);
+		}
+	}
+
+	// Migration target of island `i`: the next one of its restart group
+	uint32_t nextIsland(const uint32_t i) const {
+		for (auto& g : groups_) {
+			if (i >= g.first && i < g.last) {
+				return g.first + (i - g.first + 1) % (g.last - g.first);
+			}
+		}
+		return (i + 1) % solvers_.size();
+	}
+
+	// Called after migration(), so every solver knows its best candidate
+	void checkStagnation() {
+		using namespace std;
+		PDEBC_TRACE_SCOPE("restart");
+		vector<RestartGroup*> restarting;
+		for (auto& g : groups_) {
+			bool improved = false;
+			for (uint32_t k = g.first; k < g.last; ++k) {
+				auto bc = solvers_[k]->getBestCandidate();
+				if (better(bc, g.best)) {
+					g.best = bc;
+					improved = true;
+				}
+			}
+			if (better(g.best, elite_)) {
+				elite_ = g.best;
+			}
+			g.stagnant_generations = improved ? 0 : g.stagnant_generations + 1;
+			if (g.stagnant_generations >= restart_policy_->kStagnation_
+				&& g.restarts < restart_policy_->kMaxRestarts_) {
+				restarting.push_back(&g);
+			}
+		}
+		if (restarting.empty()) {
+			return;
+		}
+
+		// New populations are sampled here (the callbacks may not be
+		// thread safe), and evaluated by the solvers of each group at once
+		for (auto g : restarting) {
+			uint32_t total = 0;
+			vector<uint32_t> sizes;
+			for (uint32_t k = g->first; k < g->last; ++k) {
+				sizes.push_back(max(kMinIslandSize_,
+					restart_policy_->nextPopSize(solvers_[k]->getPopSize())));
+				total += sizes.back();
+			}
+			vector<array<POP_TYPE,POP_DIM>> plan(total);
+			if (restart_policy_->kType_ == RestartType::LOCAL) {
+				sampleAround<POP_TYPE,POP_DIM,ERROR_TYPE>(*this, get<1>(g->best), restart_policy_->kRadius_,
+					plan, emt_);
+				plan[0] = get<1>(g->best);
+			} else if (this->population_initializer_) {
+				this->population_initializer_->generate(plan);
+			} else {
+				for (auto& x : plan) {
+					for (int d = 0; d < POP_DIM; ++d) {
+						x[d] = this->callback_population_generator_();
+					}
+				}
+			}
+			uint32_t first = 0;
+			for (uint32_t k = g->first; k < g->last; ++k) {
+				const uint32_t n = sizes[k - g->first];
+				solvers_[k]->solveRestart(vector<array<POP_TYPE,POP_DIM>>(
+					plan.begin() + first, plan.begin() + first + n));
+				first += n;
+			}
+		}
+		for (auto g : restarting) {
+			for (uint32_t k = g->first; k < g->last; ++k) {
+				solvers_[k]->waitWork();
+				evaluations_ += solvers_[k]->getGenerationEvaluations();
+			}
+			// The group starts over, the stagnation is tracked
+			// from the best of its new population
+			++g->restarts;
+			g->stagnant_generations = 0;
+			for (uint32_t k = g->first; k < g->last; ++k) {
+				solvers_[k]->solveBestCandidate();
+			}
+			for (uint32_t k = g->first; k < g->last; ++k) {
+				solvers_[k]->waitWork();
+				auto bc = solvers_[k]->getBestCandidate();
+				if (k == g->first || better(bc, g->best)) {
+					g->best = bc;
+				}
+			}
+		}
+	}
+
+	// Called after a generation, while every solver is idle.
+	// Entities only move inside a restart group, whose islands may be
+	// restarting at different times and sizes.
+	void balanceLoad() {
+		using namespace std;
+		PDEBC_TRACE_SCOPE("balance load");
+		const uint32_t P = solvers_.size();
+		vector<uint32_t> sizes = getIslandSizes();
+
+		for (uint32_t k = 0; k < P; ++k) {
+			const double cost = solvers_[k]->getGenerationTime() / sizes[k];
+			entity_cost_[k] = entity_cost_[k] <= 0 ? cost
+				: smoothing_ * cost + (1 - smoothing_) * entity_cost_[k];
+			if (entity_cost_[k] <= 0) {
+				return; // too fast to be measured
+			}
+		}
+
+		if (groups_.empty()) {
+			balanceIslands(0, P, sizes);
+		}
+		for (auto& g : groups_) {
+			balanceIslands(g.first, g.last, sizes);
+		}
+	}
+
+	// Moves entities between the islands [first,last)
+	void balanceIslands(const uint32_t first, const uint32_t last,
+		std::vector<uint32_t>& sizes) {
+		using namespace std;
+		uint32_t N = 0;
+		for (uint32_t k = first; k < last; ++k) {
+			N += sizes[k];
+		}
+		if (last - first < 2 || N < kMinIslandSize_ * (last - first)) {
+			return;
+		}
+
+		// Ideal sizes, inversely proportional to the cost per entity
+		double inv_sum = 0;
+		for (uint32_t k = first; k < last; ++k) {
+			inv_sum += 1 / entity_cost_[k];
+		}
+		vector<double> ideal(last);
+		vector<uint32_t> targets(last);
+		uint32_t total = 0;
+		for (uint32_t k = first; k < last; ++k) {
+			ideal[k] = max<double>(kMinIslandSize_,
+				N * (1 / entity_cost_[k]) / inv_sum);
+			targets[k] = static_cast<uint32_t>(ideal[k]);
+			total += targets[k];
+		}
+		// Rounding: the largest fractions get the entities left, and the
+		// islands above their ideal size pay for the minimum size
+		while (total < N) {
+			uint32_t best = first;
+			for (uint32_t k = first + 1; k < last; ++k) {
+				if (ideal[k] - targets[k] > ideal[best] - targets[best]) {
+					best = k;
+				}
+			}
+			++targets[best];
+			++total;
+		}
+		while (total > N) {
+			uint32_t best = last;
+			for (uint32_t k = first; k < last; ++k) {
+				if (targets[k] > kMinIslandSize_ && (best == last
+					|| targets[k] - ideal[k] > targets[best] - ideal[best])) {
+					best = k;
+				}
+			}
+			--targets[best];
+			--total;
+		}
+
+		double current = 0;
+		double predicted = 0;
+		for (uint32_t k = first; k < last; ++k) {
+			current = max(current, entity_cost_[k] * sizes[k]);
+			predicted = max(predicted, entity_cost_[k] * targets[k]);
+		}
+		if (predicted > current * (1 - kMinBalanceGain_)) {
+			return;
+		}
+
+		// Random entities (with their errors) leave the islands above
+		// their target and join the ones below it
+		vector<tuple<ERROR_TYPE,array<POP_TYPE,POP_DIM>>> moving;
+		for (uint32_t k = first; k < last; ++k) {
+			for (; sizes[k] > targets[k]; --sizes[k]) {
+				moving.push_back(
+					solvers_[k]->removeIndividual(randomIndex(sizes[k])));
+			}
+		}
+		for (uint32_t k = first; k < last; ++k) {
+			for (; sizes[k] < targets[k]; ++sizes[k]) {
+				solvers_[k]->addIndividual(get<1>(moving.back()),
+					get<0>(moving.back()));
+				moving.pop_back();
+			}
+		}
+	}
+
+	// Called after a generation, while every solver is idle.
+	// Every island shrinks in proportion to its size.
+	void reducePopulation() {
+		using namespace std;
+		const uint32_t P = solvers_.size();
+		const vector<uint32_t> sizes = getIslandSizes();
+		const uint32_t N = getPopSize();
+		const uint32_t target = max(kMinIslandSize_ * P,
+			population_schedule_(evaluations_));
+		if (target >= N) {
+			return;
+		}
+
+		vector<uint32_t> targets(P);
+		vector<double> ideal(P);
+		uint32_t total = 0;
+		for (uint32_t k = 0; k < P; ++k) {
+			ideal[k] = static_cast<double>(sizes[k]) * target / N;
+			targets[k] = min(sizes[k], max(kMinIslandSize_,
+				static_cast<uint32_t>(ideal[k])));
+			total += targets[k];
+		}
+		// Largest fractions first, without growing any island
+		while (total < target) {
+			uint32_t best = P;
+			for (uint32_t k = 0; k < P; ++k) {
+				if (targets[k] < sizes[k] && (best == P
+					|| ideal[k] - targets[k] > ideal[best] - targets[best])) {
+					best = k;
+				}
+			}
+			++targets[best];
+			++total;
+		}
+
+		for (uint32_t k = 0; k < P; ++k) {
+			if (targets[k] < sizes[k]) {
+				solvers_[k]->solveShrink(targets[k]);
+			}
+		}
+		for (uint32_t k = 0; k < P; ++k) {
+			if (targets[k] < sizes[k]) {
+				solvers_[k]->waitWork();
 			}
 		}
 	}
 };
 
+template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
+constexpr uint32_t ThreadsDE<POP_TYPE,POP_DIM,ERROR_TYPE>::kMinIslandSize_;
+template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
+constexpr double ThreadsDE<POP_TYPE,POP_DIM,ERROR_TYPE>::kMinBalanceGain_;
+
+#ifdef PDEBC_EXTERN_TEMPLATES
+/// \cond DEV
+#define PDEBC_EXTERN_THREADSDE(POP_TYPE, POP_DIM, ERROR_TYPE) \
+	extern template struct ThreadsDE<POP_TYPE,POP_DIM,ERROR_TYPE>;
+PDEBC_FOR_EACH_INSTANCE(PDEBC_EXTERN_THREADSDE)
+#undef PDEBC_EXTERN_THREADSDE
+/// \endcond
+#endif
+
 } // namespace
 
 #endif /* THREADSDE_H_ */
@@ -19,20 +19,35 @@
 #ifndef THREADSDESOLVER_H_
 #define THREADSDESOLVER_H_
 
+#include <array>
+#include <vector>
 #include <thread>
 #include <random>
 #include <mutex>
 #include <condition_variable>
 #include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <memory>
  
 #include "BaseDE.hpp"
+#include "Affinity.hpp"
+#include "PopulationReduction.hpp"
+#include "Surrogate.hpp"
+#include "Constraints.hpp"
+#include "VariableTypes.hpp"
+#include "Crossover.hpp"
+#include "Random.hpp"
+#include "Trace.hpp"
 
 /// \cond DEV
 namespace pdebc {
 
 enum class WorkType {
 	SOLVE_GENERATION,
-	GET_BEST_CANDIDATE
+	GET_BEST_CANDIDATE,
+	SHRINK,
+	RESTART
 };
 
 
@@ -44,20 +59,23 @@ template <class POP_TYPE, int POP_DIM, class ERROR_TYPE>
 struct ThreadsDESolver {
 
 	const int kID_;
-	const uint32_t kPopSize_;
+	uint32_t pop_size_; // Changes when ThreadsDE balances the load
 	BaseDE<POP_TYPE,POP_DIM,ERROR_TYPE>* base_de_;
 
 	std::vector<std::array<POP_TYPE,POP_DIM>> population_;
 
 	ThreadsDESolver(const int id, const uint32_t POP_SIZE,
-		BaseDE<POP_TYPE,POP_DIM,ERROR_TYPE>* base_de)
-		: kID_{id}, kPopSize_{POP_SIZE},
-			base_de_{base_de}, finish_{false}, pending_work_{false},
-			work_ready_{false} {
-
-		population_.resize(kPopSize_);
-		pop_errors_.resize(kPopSize_);
-		
+		BaseDE<POP_TYPE,POP_DIM,ERROR_TYPE>* base_de,
+		std::vector<std::array<POP_TYPE,POP_DIM>>&& initial_population,
+		const int cpu)
+		: kID_{id}, pop_size_{POP_SIZE},
+			base_de_{base_de},
+			initial_population_{std::move(initial_population)},
+			finish_{false}, pending_work_{false},
+			work_ready_{false}, kCPU_{cpu} {
+
+		// population_ and pop_errors_ are allocated by the solver's
+		// thread (see run()), so they end up in its NUMA node.
 		using MyThreadsDESolver =
 			pdebc::ThreadsDESolver<POP_TYPE,POP_DIM,ERROR_TYPE>;
 		thread_ = std::thread(&MyThreadsDESolver::run,this);
@@ -89,10 +107,135 @@ struct ThreadsDESolver {
 		cond_.notify_one();
 	}
 
+	//! Evicts the worst entities until `n` are left.
+	void solveShrink(const uint32_t n) {
+		using namespace std;
+		unique_lock<mutex> lock(mutex_);
+		shrink_size_ = n;
+		pending_work_ = true;
+		work_ready_ = false;
+		work_type_ = WorkType::SHRINK;
+		cond_.notify_one();
+	}
+
+	//! Replaces the population by `population`, and evaluates it.
+	void solveRestart(std::vector<std::array<POP_TYPE,POP_DIM>>&& population) {
+		using namespace std;
+		unique_lock<mutex> lock(mutex_);
+		initial_population_ = std::move(population);
+		pending_work_ = true;
+		work_ready_ = false;
+		work_type_ = WorkType::RESTART;
+		cond_.notify_one();
+	}
+
 	std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>> getBestCandidate() const {
 		return best_candidate_;
 	}
 
+	//! Number of entities in this solver.
+	uint32_t getPopSize() const {
+		return pop_size_;
+	}
+
+	//! Seconds spent on the last generation.
+	double getGenerationTime() const {
+		return generation_time_;
+	}
+
+	//! Calls to the error function in the last generation.
+	uint32_t getGenerationEvaluations() const {
+		return generation_evaluations_;
+	}
+
+	//! Trials discarded by the surrogate so far.
+	uint64_t getSkippedEvaluations() const {
+		return skipped_evaluations_;
+	}
+
+	//! Trials rejected by the constraints so far.
+	uint64_t getInfeasibleTrials() const {
+		return infeasible_trials_;
+	}
+
+	//! Constraints shared by every island.
+	/*!
+		Installed by the solver's thread at the start of the next
+		generation, like the surrogate.
+	*/
+	void setConstraints(
+		const std::shared_ptr<const ConstraintHandler<POP_TYPE,POP_DIM>>& constraints) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		new_constraints_ = constraints;
+	}
+
+	//! Installed by the solver's thread when it wakes up.
+	void setVariableTypes(
+		const std::shared_ptr<const VariableTypes<POP_DIM>>& types) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		new_variable_types_ = types;
+	}
+
+	//! Island's own surrogate, learns from the local population.
+	/*!
+		It's installed by the solver's thread at the start of the next
+		generation (the initial population may still be under evaluation).
+	*/
+	void setSurrogate(const KNNSurrogate<POP_TYPE,POP_DIM,ERROR_TYPE>& surrogate) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		new_surrogate_ = std::make_shared<KNNSurrogate<POP_TYPE,POP_DIM,ERROR_TYPE>>(
+			surrogate);
+	}
+
+	//! Replaces entity `i` (error included).
+	/*!
+		Only call it while the solver is idle (after waitWork()).
+	*/
+	void setIndividual(const uint32_t i,
+		const std::array<POP_TYPE,POP_DIM>& individual, const ERROR_TYPE& error) {
+		population_[i] = individual;
+		pop_errors_[i] = error;
+		pop_violations_[i] = violation(individual);
+	}
+
+	//! Removes entity `i`, the last one takes its place.
+	/*!
+		Only call it while the solver is idle (after waitWork()).
+	*/
+	std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>> removeIndividual(
+		const uint32_t i) {
+		auto r = std::make_tuple(pop_errors_[i], population_[i]);
+		population_[i] = population_.back();
+		pop_errors_[i] = pop_errors_.back();
+		pop_violations_[i] = pop_violations_.back();
+		population_.pop_back();
+		pop_errors_.pop_back();
+		pop_violations_.pop_back();
+		--pop_size_;
+		return r;
+	}
+
+	//! Replaces the worst entity by `individual`.
+	/*!
+		Only call it while the solver is idle (after waitWork()).
+	*/
+	void replaceWorst(const std::array<POP_TYPE,POP_DIM>& individual,
+		const ERROR_TYPE& error) {
+		setIndividual(worstIndex(), individual, error);
+	}
+
+	//! Appends an entity.
+	/*!
+		Only call it while the solver is idle (after waitWork()).
+	*/
+	void addIndividual(const std::array<POP_TYPE,POP_DIM>& individual,
+		const ERROR_TYPE& error) {
+		population_.push_back(individual);
+		pop_errors_.push_back(error);
+		pop_violations_.push_back(violation(individual));
+		++pop_size_;
+	}
+
 	void waitWork() {
 		using namespace std;
 		unique_lock<mutex> lock(work_ready_lock_);
@@ -100,44 +243,75 @@ struct ThreadsDESolver {
 	}
 
 private:
-	std::function<double()> random_cr_;
+	SplitMix64 emt_crossover_;
+	const BinomialCrossover<POP_TYPE,POP_DIM> crossover_{base_de_->kCR_};
 	std::function<uint32_t()> random_trials_;
 	std::function<uint32_t()> random_j_;
 
-	template <class T, unsigned I, unsigned J>
-	using Matrix = std::array<std::array<T, J>, I>;
-
-	Matrix<POP_TYPE, 3, POP_DIM> pop_trials_; // Used in "mutation"
-
 	std::array<POP_TYPE, POP_DIM> pop_candidate_;
 	std::vector<ERROR_TYPE> pop_errors_;
+	std::vector<double> pop_violations_; // All 0 without constraints
 
 	std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>> best_candidate_;
+	double generation_time_{0};
+	uint32_t generation_evaluations_{0};
+	uint64_t skipped_evaluations_{0};
+	std::shared_ptr<KNNSurrogate<POP_TYPE,POP_DIM,ERROR_TYPE>> surrogate_;
+	std::shared_ptr<KNNSurrogate<POP_TYPE,POP_DIM,ERROR_TYPE>> new_surrogate_;
+	std::shared_ptr<const ConstraintHandler<POP_TYPE,POP_DIM>> constraints_;
+	std::shared_ptr<const ConstraintHandler<POP_TYPE,POP_DIM>> new_constraints_;
+	std::shared_ptr<const VariableTypes<POP_DIM>> variable_types_;
+	std::shared_ptr<const VariableTypes<POP_DIM>> new_variable_types_;
+	uint32_t pending_evaluations_{0}; // Done on wake, counted by the next generation
+	uint64_t generation_{0}; // Sets the epsilon level
+	uint64_t infeasible_trials_{0};
+
+	// Slice of the PopulationInitializer plan, if any, or of a restart
+	std::vector<std::array<POP_TYPE,POP_DIM>> initial_population_;
 
 	// Threads Flow Control
-	std::thread thread_;
+	// Padded so the flags written by ThreadsDE and the ones written by
+	// the solver's thread don't share cache lines (with each other nor
+	// with the neighbour solvers).
+	char pad0_[kCacheLineSize];
 	std::mutex mutex_;
 	std::condition_variable cond_;
 	bool pending_work_;
 	bool finish_;
-	bool work_ready_;
 	WorkType work_type_;
+	uint32_t shrink_size_;
+	char pad1_[kCacheLineSize];
+	bool work_ready_;
 	std::mutex work_ready_lock_;
 	std::condition_variable work_ready_cond_;
+	char pad2_[kCacheLineSize];
+	std::thread thread_;
+	const int kCPU_; // -1 means no pinning
 
 	void run() {
 
 		using namespace std;
 		{ // this scope will be called only once
-			// Initialize random_cr_
-			mt19937 emt(random_device{}());
-			uniform_real_distribution<double> ud(0.0, 1.0);
-			random_cr_ = bind(ud, emt);
+			PDEBC_TRACE_THREAD_NAME("island " + std::to_string(kID_));
+			if (kCPU_ >= 0) {
+				pinThisThread(kCPU_);
+			}
+			// First touch: the pages go to the node running this thread
+			population_.resize(pop_size_);
+			pop_errors_.resize(pop_size_);
+			pop_violations_.assign(pop_size_, 0);
+
+			// Initialize the crossover mask's engine
+			random_device rd;
+			emt_crossover_ = SplitMix64((static_cast<uint64_t>(rd()) << 32) | rd());
 
 			// Initialize random_trials_
 			mt19937 emt2(random_device{}());
-			uniform_int_distribution<uint32_t> ui2(0, kPopSize_-1);
-			random_trials_ = bind(ui2, emt2);
+			// The population size may change between generations
+			random_trials_ = [this,emt2]() mutable -> uint32_t {
+				return uniform_int_distribution<uint32_t>(
+					0, this->pop_size_-1)(emt2);
+			};
 
 			// Initialize random_j_
 			mt19937 emt3(random_device{}());
@@ -146,14 +320,51 @@ private:
 
 			generatePopulation();
 			calcGenerationError();
+			if (base_de_->population_initializer_
+				&& base_de_->population_initializer_->kOpposition_) {
+				oppositionSelection();
+			}
 		}
 
 		while (!finish_) {
 			// non-busy wait for more work
 			unique_lock<mutex> lock(mutex_);
-			cond_.wait(lock, [this]() {
-				return this->pending_work_;
-			});
+			{
+				PDEBC_TRACE_SCOPE("wait");
+				cond_.wait(lock, [this]() {
+					return this->pending_work_;
+				});
+			}
+			if (new_constraints_) {
+				constraints_.swap(new_constraints_);
+				new_constraints_.reset();
+				for (uint32_t i = 0; i < pop_size_; ++i) {
+					pop_violations_[i] = violation(population_[i]);
+				}
+			}
+			if (new_variable_types_) {
+				variable_types_.swap(new_variable_types_);
+				new_variable_types_.reset();
+				for (uint32_t i = 0; i < pop_size_; ++i) {
+					if (variable_types_->repair(population_[i])) {
+						pop_violations_[i] = violation(population_[i]);
+						if (feasible(pop_violations_[i])) {
+							pop_errors_[i] =
+								base_de_->callback_calc_error_(population_[i]);
+							++pending_evaluations_;
+						}
+					}
+				}
+			}
+			if (new_surrogate_) {
+				surrogate_.swap(new_surrogate_);
+				new_surrogate_.reset();
+				for (uint32_t i = 0; i < pop_size_; ++i) {
+					if (feasible(pop_violations_[i])) {
+						surrogate_->add(population_[i], pop_errors_[i]);
+					}
+				}
+			}
 			lock.unlock();
 
 			if (finish_) {
@@ -162,19 +373,58 @@ private:
 
 
 			if (work_type_ == WorkType::SOLVE_GENERATION) {
-				for (uint32_t i = 0; i < kPopSize_; ++i) {
-					mutation(i);
+				PDEBC_TRACE_SCOPE("generation");
+				const auto start = chrono::steady_clock::now();
+				generation_evaluations_ = pending_evaluations_;
+				pending_evaluations_ = 0;
+				for (uint32_t i = 0; i < pop_size_; ++i) {
+					{
+						PDEBC_TRACE_SCOPE("mutation");
+						mutation(i);
+					}
 					select(i);
 				}
+				++generation_;
+				generation_time_ = chrono::duration<double>(
+					chrono::steady_clock::now() - start).count();
 			} else if (work_type_ == WorkType::GET_BEST_CANDIDATE) {
-				auto e = std::min_element(pop_errors_.begin(),
-					pop_errors_.end(),
-					base_de_->callback_error_evaluation_);
-
-				auto min = std::distance(pop_errors_.begin(), e);
+				PDEBC_TRACE_SCOPE("best candidate");
+				const uint32_t min = bestIndex();
 				std::array<POP_TYPE,POP_DIM> r = population_[min];
 
 				best_candidate_ = make_tuple(pop_errors_[min],r);
+			} else if (work_type_ == WorkType::SHRINK) {
+				PDEBC_TRACE_SCOPE("shrink");
+				// Compacted by this thread, the new storage
+				// stays in its NUMA node
+				evictWorst(population_, pop_errors_, pop_violations_,
+					shrink_size_, [this](const uint32_t a, const uint32_t b) {
+						return this->better(a, b);
+					});
+				pop_size_ = population_.size();
+			} else if (work_type_ == WorkType::RESTART) {
+				PDEBC_TRACE_SCOPE("restart");
+				// The buffers are reused, they only grow if needed
+				pop_size_ = initial_population_.size();
+				population_.resize(pop_size_);
+				pop_errors_.resize(pop_size_);
+				pop_violations_.resize(pop_size_);
+				generatePopulation();
+				if (variable_types_) {
+					for (auto& x : population_) {
+						variable_types_->repair(x);
+					}
+				}
+				generation_evaluations_ = pending_evaluations_;
+				pending_evaluations_ = 0;
+				calcGenerationError();
+				if (surrogate_) {
+					for (uint32_t i = 0; i < pop_size_; ++i) {
+						if (feasible(pop_violations_[i])) {
+							surrogate_->add(population_[i], pop_errors_[i]);
+						}
+					}
+				}
 			}
 
 
@@ -188,7 +438,15 @@ private:
 	}
 
 	void generatePopulation() {
-		for (uint32_t i = 0; i < kPopSize_; ++i) {
+		if (!initial_population_.empty()) {
+			// Copied, not swapped, so it stays in this thread's pages
+			std::copy(initial_population_.begin(), initial_population_.end(),
+				population_.begin());
+			initial_population_.clear();
+			initial_population_.shrink_to_fit();
+			return;
+		}
+		for (uint32_t i = 0; i < pop_size_; ++i) {
 			for (int d = 0; d < POP_DIM; ++d) {
 				population_[i][d] =
 					base_de_->callback_population_generator_();
@@ -196,18 +454,42 @@ private:
 		}
 	}
 
+	// Entities violating the constraints are not evaluated
 	void calcGenerationError() {
-		for (uint32_t i = 0; i < kPopSize_; ++i) {
+		for (uint32_t i = 0; i < pop_size_; ++i) {
 			for (int d = 0; d < POP_DIM; ++d) {
 				pop_candidate_[d] = population_[i][d];
 			}
-			pop_errors_[i] = 
-				base_de_->callback_calc_error_(pop_candidate_);
+			pop_violations_[i] = violation(pop_candidate_);
+			if (feasible(pop_violations_[i])) {
+				pop_errors_[i] = 
+					base_de_->callback_calc_error_(pop_candidate_);
+				++generation_evaluations_;
+			}
 		}
 	}
 
+	// Evaluates the opposite of every local entity and keeps the
+	// best pop_size_ of both. Only called on start, before any
+	// constraint is set.
+	void oppositionSelection() {
+		using namespace std;
+		vector<array<POP_TYPE,POP_DIM>> opposites(pop_size_);
+		vector<ERROR_TYPE> opposite_errors(pop_size_);
+		for (uint32_t i = 0; i < pop_size_; ++i) {
+			opposites[i] =
+				base_de_->population_initializer_->opposite(population_[i]);
+			opposite_errors[i] = base_de_->callback_calc_error_(opposites[i]);
+		}
+
+		PopulationInitializer<POP_TYPE,POP_DIM>::selectOpposition(population_,
+			pop_errors_, opposites, opposite_errors,
+			base_de_->callback_error_evaluation_);
+	}
+
 	void mutation(const uint32_t actual_index) {
-		int j = random_j_();
+		const int j = random_j_();
+		const MutationType<POP_TYPE> F = static_cast<MutationType<POP_TYPE>>(base_de_->kF_);
 
 		const uint32_t it0 = random_trials_();
 		uint32_t it1 = random_trials_();
@@ -219,42 +501,111 @@ private:
 			it2 = random_trials_();
 		}
 
-		pop_trials_[0] = population_[it0];
-		pop_trials_[1] = population_[it1];
-		pop_trials_[2] = population_[it2];
-
-		pop_candidate_[j] = pop_trials_[0][j] + base_de_->kF_
-			* (pop_trials_[1][j] - pop_trials_[2][j]);
-		j = (j + 1) % POP_DIM;
-
-		for (int k = 1; k < POP_DIM; ++k) {
-			if (random_cr_() <= base_de_->kCR_) {
-				pop_candidate_[j] = pop_trials_[0][j]
-					+ base_de_->kF_ * (pop_trials_[1][j]
-					- pop_trials_[2][j]);
-		    } else {
-		      	pop_candidate_[j] = population_[actual_index][j];
-		    }
-		    j = (j + 1) % POP_DIM;
-	    }
+		crossover_.apply(emt_crossover_, j, F, population_[it0],
+			population_[it1], population_[it2], population_[actual_index],
+			pop_candidate_);
+		if (variable_types_) {
+			variable_types_->repair(pop_candidate_);
+		}
 	}
 	
 
 	void select(const uint32_t actual_index) {
-		ERROR_TYPE error_new = base_de_->callback_calc_error_(
-				pop_candidate_);
+		double violation_new = 0;
+		if (constraints_) {
+			// The cheap check goes first, infeasible trials are
+			// compared by their violation only
+			violation_new = constraints_->callback_violation_(pop_candidate_);
+			if (!feasible(violation_new)) {
+				++infeasible_trials_;
+				if (violation_new < pop_violations_[actual_index]) {
+					population_[actual_index] = pop_candidate_;
+					pop_violations_[actual_index] = violation_new;
+				}
+				return;
+			}
+		}
+		// An infeasible target loses anyway, no need to screen
+		if (surrogate_ && feasible(pop_violations_[actual_index])
+			&& !surrogate_->promising(pop_candidate_,
+				pop_errors_[actual_index], base_de_->callback_error_evaluation_)) {
+			++skipped_evaluations_;
+			return;
+		}
+		ERROR_TYPE error_new = evaluateCandidate();
+		++generation_evaluations_;
+		if (surrogate_) {
+			surrogate_->add(pop_candidate_, error_new);
+		}
 
-		if (base_de_->callback_error_evaluation_(
-				error_new, pop_errors_[actual_index])) {
+		if (better(error_new, violation_new,
+				pop_errors_[actual_index], pop_violations_[actual_index])) {
 			for (int d = 0; d < POP_DIM; d++) {
 				population_[actual_index][d] =
 					pop_candidate_[d];
 			}
 			pop_errors_[actual_index] = error_new;
+			pop_violations_[actual_index] = violation_new;
+		}
+	}
+
+	ERROR_TYPE evaluateCandidate() {
+		PDEBC_TRACE_SCOPE("evaluation");
+		return base_de_->callback_calc_error_(pop_candidate_);
+	}
+
+	double violation(const std::array<POP_TYPE,POP_DIM>& x) const {
+		return constraints_ ? constraints_->callback_violation_(x) : 0;
+	}
+
+	bool feasible(const double violation) const {
+		return !constraints_ || violation <= constraints_->epsilon(generation_);
+	}
+
+	// Deb's rules with constraints, the error evaluation otherwise
+	bool better(const ERROR_TYPE& error_a, const double violation_a,
+		const ERROR_TYPE& error_b, const double violation_b) const {
+		if (!constraints_) {
+			return base_de_->callback_error_evaluation_(error_a, error_b);
 		}
+		return ConstraintHandler<POP_TYPE,POP_DIM>::better(error_a, violation_a,
+			error_b, violation_b, constraints_->epsilon(generation_),
+			base_de_->callback_error_evaluation_);
+	}
+
+	bool better(const uint32_t a, const uint32_t b) const {
+		return better(pop_errors_[a], pop_violations_[a],
+			pop_errors_[b], pop_violations_[b]);
+	}
+
+	uint32_t bestIndex() const {
+		uint32_t best = 0;
+		for (uint32_t i = 1; i < pop_size_; ++i) {
+			if (better(i, best)) {
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	uint32_t worstIndex() const {
+		uint32_t worst = 0;
+		for (uint32_t i = 1; i < pop_size_; ++i) {
+			if (better(worst, i)) {
+				worst = i;
+			}
+		}
+		return worst;
 	}
 };
 
+#ifdef PDEBC_EXTERN_TEMPLATES
+#define PDEBC_EXTERN_THREADSDESOLVER(POP_TYPE, POP_DIM, ERROR_TYPE) \
+	extern template struct ThreadsDESolver<POP_TYPE,POP_DIM,ERROR_TYPE>;
+PDEBC_FOR_EACH_INSTANCE(PDEBC_EXTERN_THREADSDESOLVER)
+#undef PDEBC_EXTERN_THREADSDESOLVER
+#endif
+
 };
 /// \endcond
 
@@ -0,0 +1,272 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#ifndef TRACE_HPP_
+#define TRACE_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <fstream>
+#include <stdexcept>
+
+//! Span recording, for a timeline of what each thread does.
+/*!
+	Define PDEBC_ENABLE_TRACE (before including any pdebc header, or with
+	-DPDEBC_ENABLE_TRACE) to record them. Otherwise the macros below
+	expand to nothing, and no tracing code is compiled into the engines.
+
+	- PDEBC_TRACE_SCOPE(name): records a span from here to the end of the
+		scope. `name` must be a string literal (only the pointer is kept).
+	- PDEBC_TRACE_THREAD_NAME(name): names the calling thread in the trace.
+
+	Each thread writes its spans into its own ring buffer of
+	PDEBC_TRACE_BUFFER_SIZE spans (the oldest are overwritten), so
+	recording doesn't lock nor share cache lines. saveChromeTrace() writes
+	every buffer as Chrome trace-event JSON, for chrome://tracing or
+	https://ui.perfetto.dev. The buffer of a thread that has ended is
+	freed once it's written (or cleared), so the threads of earlier runs
+	don't hold memory forever.
+
+	ThreadsDE records, for each island thread, the "wait" for work,
+	"generation", "mutation", "evaluation", "best candidate", "shrink"
+	and "restart" spans; and for the calling thread, "generation",
+	"wait islands", "migration", "balance load" and "restart".
+*/
+#ifdef PDEBC_ENABLE_TRACE
+#define PDEBC_TRACE_CONCAT_(a, b) a##b
+#define PDEBC_TRACE_CONCAT(a, b) PDEBC_TRACE_CONCAT_(a, b)
+#define PDEBC_TRACE_SCOPE(name) \
+	::pdebc::TraceScope PDEBC_TRACE_CONCAT(pdebc_trace_scope_, __LINE__)(name)
+#define PDEBC_TRACE_THREAD_NAME(name) ::pdebc::setTraceThreadName(name)
+#else
+#define PDEBC_TRACE_SCOPE(name) do {} while (0)
+#define PDEBC_TRACE_THREAD_NAME(name) do {} while (0)
+#endif
+
+#ifndef PDEBC_TRACE_BUFFER_SIZE
+#define PDEBC_TRACE_BUFFER_SIZE (1 << 16)
+#endif
+
+namespace pdebc {
+
+/// \cond DEV
+//! One recorded span.
+struct TraceEvent {
+	const char* name;
+	uint64_t start; // ns since traceNow()'s epoch
+	uint64_t duration; // ns
+};
+
+//! Spans of one thread. Only its thread writes it.
+struct TraceBuffer {
+	const uint32_t kTid_;
+	std::string name_;
+	std::vector<TraceEvent> events_;
+	std::atomic<uint64_t> count_; // Spans written so far
+	std::atomic<bool> finished_; // Its thread ended, no more spans
+
+	explicit TraceBuffer(const uint32_t tid) :
+		kTid_{tid}, events_(PDEBC_TRACE_BUFFER_SIZE), count_{0},
+		finished_{false} {
+
+	}
+
+	void add(const char* name, const uint64_t start, const uint64_t end) {
+		const uint64_t c = count_.load(std::memory_order_relaxed);
+		events_[c % events_.size()] = TraceEvent{name, start, end - start};
+		count_.store(c + 1, std::memory_order_release);
+	}
+};
+
+//! Every buffer not freed yet. They outlive their threads until
+//! they're written or cleared.
+struct TraceRegistry {
+	std::mutex mutex_;
+	std::vector<std::shared_ptr<TraceBuffer>> buffers_;
+	uint32_t next_tid_{1};
+
+	//! Frees the buffers of the ended threads. `finished` was read before
+	//! their spans, so none is lost. Called with mutex_ held.
+	void release(const std::vector<bool>& finished) {
+		uint32_t kept = 0;
+		for (uint32_t i = 0; i < buffers_.size(); ++i) {
+			if (!finished[i]) {
+				buffers_[kept++] = buffers_[i];
+			}
+		}
+		buffers_.resize(kept);
+	}
+};
+
+inline TraceRegistry& traceRegistry() {
+	static TraceRegistry registry;
+	return registry;
+}
+
+//! Nanoseconds since the first call.
+inline uint64_t traceNow() {
+	using namespace std::chrono;
+	static const steady_clock::time_point epoch = steady_clock::now();
+	return duration_cast<nanoseconds>(steady_clock::now() - epoch).count();
+}
+
+//! Marks the buffer finished when its thread ends.
+struct TraceBufferOwner {
+	std::shared_ptr<TraceBuffer> buffer_;
+
+	~TraceBufferOwner() {
+		if (buffer_) {
+			buffer_->finished_.store(true, std::memory_order_release);
+		}
+	}
+};
+
+//! Buffer of the calling thread, created on its first span.
+inline TraceBuffer& traceBuffer() {
+	static thread_local TraceBufferOwner owner;
+	if (!owner.buffer_) {
+		auto& registry = traceRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex_);
+		owner.buffer_ = std::make_shared<TraceBuffer>(registry.next_tid_++);
+		registry.buffers_.push_back(owner.buffer_);
+	}
+	return *owner.buffer_;
+}
+
+//! Records a span over its lifetime. See PDEBC_TRACE_SCOPE.
+struct TraceScope {
+	explicit TraceScope(const char* name) :
+		kName_{name}, start_{traceNow()} {
+
+	}
+	~TraceScope() {
+		traceBuffer().add(kName_, start_, traceNow());
+	}
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	const char* const kName_;
+	const uint64_t start_;
+};
+
+//! See PDEBC_TRACE_THREAD_NAME.
+inline void setTraceThreadName(const std::string& name) {
+	auto& buffer = traceBuffer();
+	std::lock_guard<std::mutex> lock(traceRegistry().mutex_);
+	buffer.name_ = name;
+}
+
+inline void writeTraceString(std::ostream& out, const std::string& s) {
+	out << '"';
+	for (char c : s) {
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			char hex[8];
+			std::snprintf(hex, sizeof(hex), "\\u%04x", c);
+			out << hex;
+		} else {
+			out << c;
+		}
+	}
+	out << '"';
+}
+/// \endcond
+
+//! Writes the recorded spans as Chrome trace-event JSON.
+/*!
+	Call it while the traced engines are idle (between generations), the
+	spans of a running thread might be overwritten while they are read.
+	The buffers of the threads that have ended are freed afterwards, so
+	their spans are only written once. Without PDEBC_ENABLE_TRACE, the
+	trace is empty.
+*/
+inline void writeChromeTrace(std::ostream& out) {
+	auto& registry = traceRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex_);
+	std::vector<bool> finished(registry.buffers_.size());
+	for (uint32_t i = 0; i < finished.size(); ++i) {
+		finished[i] = registry.buffers_[i]->finished_.load(std::memory_order_acquire);
+	}
+	bool first = true;
+	auto separator = [&]() {
+		out << (first ? "\n" : ",\n");
+		first = false;
+	};
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	for (auto& b : registry.buffers_) {
+		separator();
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+			<< b->kTid_ << ",\"args\":{\"name\":";
+		writeTraceString(out, b->name_.empty()
+			? "thread " + std::to_string(b->kTid_) : b->name_);
+		out << "}}";
+
+		const uint64_t count = b->count_.load(std::memory_order_acquire);
+		const uint64_t size = b->events_.size();
+		const uint64_t first_event = count > size ? count - size : 0;
+		for (uint64_t i = first_event; i < count; ++i) {
+			const TraceEvent& e = b->events_[i % size];
+			char times[64];
+			// Microseconds, with ns precision
+			std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+				e.start / 1e3, e.duration / 1e3);
+			separator();
+			out << "{\"name\":";
+			writeTraceString(out, e.name);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->kTid_
+				<< "," << times << "}";
+		}
+	}
+	out << "\n]}\n";
+	registry.release(finished);
+}
+
+//! Writes the recorded spans to `path`. See writeChromeTrace().
+inline void saveChromeTrace(const std::string& path) {
+	std::ofstream out(path.c_str());
+	if (!out) {
+		throw std::runtime_error("Can't open " + path);
+	}
+	writeChromeTrace(out);
+}
+
+//! Forgets the recorded spans, and frees the buffers of the threads
+//! that have ended. Same rules as writeChromeTrace().
+inline void clearTrace() {
+	auto& registry = traceRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex_);
+	std::vector<bool> finished(registry.buffers_.size());
+	for (uint32_t i = 0; i < finished.size(); ++i) {
+		finished[i] = registry.buffers_[i]->finished_.load(std::memory_order_acquire);
+		registry.buffers_[i]->count_.store(0, std::memory_order_relaxed);
+	}
+	registry.release(finished);
+}
+
+} // end namespace pdebc
+
+#endif /* TRACE_HPP_ */
@@ -0,0 +1,234 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#include "TrajectoryLogger.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace pdebc {
+
+namespace {
+
+const char kMagic[8] = {'P','D','E','B','C','T','R','J'};
+const uint32_t kVersion = 1;
+const uint32_t kNStats = 6; // min, 25%, median, 75%, max, mean
+
+void errorStats(std::vector<double> errors, double* stats) {
+	if (errors.empty()) {
+		std::fill(stats, stats + kNStats, 0.0);
+		return;
+	}
+	const std::size_t N = errors.size();
+	std::sort(errors.begin(), errors.end());
+	double sum = 0;
+	for (auto e : errors) {
+		sum += e;
+	}
+	stats[0] = errors.front();
+	stats[1] = errors[(N - 1) / 4];
+	stats[2] = errors[(N - 1) / 2];
+	stats[3] = errors[3 * (N - 1) / 4];
+	stats[4] = errors.back();
+	stats[5] = sum / N;
+}
+
+} // end anonymous namespace
+
+TrajectoryLogger::TrajectoryLogger(const std::string& path, const uint32_t dim,
+	const uint32_t population_stride, const uint32_t queue_capacity,
+	const uint32_t block_size, const bool drop_when_full) :
+		kDim_{dim}, kPopulationStride_{population_stride},
+		kQueueCapacity_{std::max<uint32_t>(1, queue_capacity)},
+		kBlockSize_{std::max<uint32_t>(1, block_size)},
+		kDropWhenFull_{drop_when_full},
+		file_{nullptr}, writing_{0}, closing_{false}, closed_{false}, dropped_{0} {
+
+	file_ = std::fopen(path.c_str(), "wb");
+	if (file_ == nullptr) {
+		throw TrajectoryLoggerError(path + ": " + std::strerror(errno));
+	}
+	write(kMagic, sizeof(kMagic));
+	write(&kVersion, sizeof(kVersion));
+	write(&kDim_, sizeof(kDim_));
+	if (!error_.empty()) {
+		std::fclose(file_);
+		throw TrajectoryLoggerError(error_);
+	}
+	writer_ = std::thread(&TrajectoryLogger::run, this);
+}
+
+TrajectoryLogger::~TrajectoryLogger() {
+	try {
+		close();
+	} catch (...) {
+		// Nothing to do about it here
+	}
+}
+
+void TrajectoryLogger::log(const uint64_t generation, const double best_error,
+	const double* best, const double* errors, const uint32_t n,
+	const double* population) {
+	Snapshot s;
+	s.generation = generation;
+	s.best_error = best_error;
+	s.best.assign(best, best + kDim_);
+	s.errors.assign(errors, errors + n);
+	if (population != nullptr && wantsPopulation(generation)) {
+		s.population.assign(population, population + static_cast<std::size_t>(n) * kDim_);
+	}
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (!error_.empty()) {
+		throw TrajectoryLoggerError(error_);
+	}
+	if (closing_) {
+		return;
+	}
+	// The block being written still counts, its memory isn't free yet
+	if (queue_.size() + writing_ >= kQueueCapacity_) {
+		if (kDropWhenFull_) {
+			++dropped_;
+			return;
+		}
+		space_cond_.wait(lock, [this]() {
+			return this->queue_.size() + this->writing_ < this->kQueueCapacity_
+				|| !this->error_.empty();
+		});
+		if (!error_.empty()) {
+			throw TrajectoryLoggerError(error_);
+		}
+	}
+	queue_.push_back(std::move(s));
+	queue_cond_.notify_one();
+}
+
+void TrajectoryLogger::close() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (closed_) {
+			return;
+		}
+		closed_ = true;
+		closing_ = true;
+	}
+	queue_cond_.notify_one();
+	writer_.join();
+	if (std::fclose(file_) != 0 && error_.empty()) {
+		error_ = std::string("fclose: ") + std::strerror(errno);
+	}
+	if (!error_.empty()) {
+		throw TrajectoryLoggerError(error_);
+	}
+}
+
+uint64_t TrajectoryLogger::getDropped() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return dropped_;
+}
+
+void TrajectoryLogger::run() {
+	std::vector<Snapshot> block;
+	for (;;) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		queue_cond_.wait(lock, [this]() {
+			return !this->queue_.empty() || this->closing_;
+		});
+		if (queue_.empty()) {
+			return; // Closing, and everything is written
+		}
+		// Whatever is queued goes now, even a partial block. While it's
+		// written the queue fills again, so under load the blocks grow.
+		while (!queue_.empty() && block.size() < kBlockSize_) {
+			block.push_back(std::move(queue_.front()));
+			queue_.pop_front();
+		}
+		writing_ = block.size();
+		lock.unlock();
+
+		writeBlock(block);
+		block.clear();
+
+		lock.lock();
+		writing_ = 0;
+		const bool failed = !error_.empty();
+		lock.unlock();
+		space_cond_.notify_all();
+		if (failed) {
+			return;
+		}
+	}
+}
+
+void TrajectoryLogger::writeBlock(const std::vector<Snapshot>& block) {
+	const uint32_t n = block.size();
+	std::vector<double> stats(n * kNStats);
+	for (uint32_t i = 0; i < n; ++i) {
+		errorStats(block[i].errors, &stats[i * kNStats]);
+	}
+
+	write(&n, sizeof(n));
+	for (auto& s : block) {
+		write(&s.generation, sizeof(s.generation));
+	}
+	for (auto& s : block) {
+		const uint32_t size = s.errors.size();
+		write(&size, sizeof(size));
+	}
+	for (auto& s : block) {
+		write(&s.best_error, sizeof(s.best_error));
+	}
+	for (auto& s : block) {
+		write(s.best.data(), kDim_ * sizeof(double));
+	}
+	write(stats.data(), stats.size() * sizeof(double));
+
+	uint32_t n_populations = 0;
+	for (auto& s : block) {
+		n_populations += s.population.empty() ? 0 : 1;
+	}
+	write(&n_populations, sizeof(n_populations));
+	for (auto& s : block) {
+		if (s.population.empty()) {
+			continue;
+		}
+		const uint32_t size = s.errors.size();
+		write(&s.generation, sizeof(s.generation));
+		write(&size, sizeof(size));
+		write(s.errors.data(), size * sizeof(double));
+		write(s.population.data(), s.population.size() * sizeof(double));
+	}
+	if (std::fflush(file_) != 0) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (error_.empty()) {
+			error_ = std::string("fflush: ") + std::strerror(errno);
+		}
+	}
+}
+
+void TrajectoryLogger::write(const void* data, const std::size_t size) {
+	if (size > 0 && std::fwrite(data, size, 1, file_) != 1) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (error_.empty()) {
+			error_ = std::string("fwrite: ") + std::strerror(errno);
+		}
+	}
+}
+
+} // end namespace pdebc
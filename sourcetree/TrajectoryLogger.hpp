@@ -0,0 +1,179 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#ifndef TRAJECTORYLOGGER_HPP_
+#define TRAJECTORYLOGGER_HPP_
+
+#include <array>
+#include <vector>
+#include <deque>
+#include <string>
+#include <tuple>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+
+namespace pdebc {
+
+//! Streams per generation snapshots of a run to a binary file.
+/*!
+	TrajectoryLogger::log() only copies the snapshot into a bounded queue;
+	a background thread computes the error distribution and writes the
+	file, so the generation loop doesn't wait for the disk (unless the
+	queue is full, see the `drop_when_full` parameter). The writer takes
+	everything queued when it wakes, up to `block_size` snapshots, so the
+	file is never far behind the run, and the blocks grow when the run
+	outpaces the disk.
+
+	Each snapshot has the generation, the best error, the best entity, the
+	population size and the distribution of the errors (min, quartiles,
+	max and mean). Every `population_stride` generations, the entire
+	population and its errors are saved too.
+
+	The file is columnar, in native endianness:
+	- header: `char[8] "PDEBCTRJ"`, `uint32 version` (1), `uint32 dim`;
+	- blocks of up to `block_size` snapshots: `uint32 n`, then the columns
+		`uint64 generation[n]`, `uint32 pop_size[n]`, `double best_error[n]`,
+		`double best[n][dim]`, `double error_stats[n][6]`, then
+		`uint32 n_populations` and for each one `uint64 generation`,
+		`uint32 size`, `double errors[size]`, `double population[size][dim]`.
+
+	samples/trajectory/pdebc_trajectory.py reads it into numpy arrays.
+	I/O errors are reported by the next call, with TrajectoryLoggerError.
+*/
+struct TrajectoryLogger {
+
+	const uint32_t kDim_; ///< Population dimensions.
+	const uint32_t kPopulationStride_; ///< Generations between population snapshots, 0 for none.
+	const uint32_t kQueueCapacity_; ///< Snapshots queued or being written, at most.
+	const uint32_t kBlockSize_; ///< Snapshots per block.
+	const bool kDropWhenFull_; ///< Drop snapshots instead of waiting when the queue is full.
+
+	/*!
+		\param path File to create (or truncate).
+		\param dim Population dimensions.
+		\param population_stride Generations between population snapshots,
+			0 to never save the population.
+		\param queue_capacity Snapshots queued or being written, at most.
+		\param block_size Snapshots per block of the file, at most.
+		\param drop_when_full When the queue is full, drop the snapshot
+			(see getDropped()) instead of waiting for the writer.
+	*/
+	TrajectoryLogger(const std::string& path, const uint32_t dim,
+		const uint32_t population_stride = 0, const uint32_t queue_capacity = 64,
+		const uint32_t block_size = 256, const bool drop_when_full = false);
+
+	//! Writes what's left and closes the file. See close().
+	~TrajectoryLogger();
+
+	TrajectoryLogger(const TrajectoryLogger&) = delete;
+	TrajectoryLogger& operator=(const TrajectoryLogger&) = delete;
+
+	//! True if the population of `generation` will be saved.
+	/*!
+		Check it before building the population for log().
+	*/
+	bool wantsPopulation(const uint64_t generation) const {
+		return kPopulationStride_ > 0 && generation % kPopulationStride_ == 0;
+	}
+
+	//! Queues the snapshot of a generation.
+	/*!
+		\param generation Generation number.
+		\param best_error Best error.
+		\param best Best entity, `dim` values.
+		\param errors Errors of the population, `n` values.
+		\param n Population size.
+		\param population Row major (n x dim) population, only read when
+			wantsPopulation(generation). May be null.
+	*/
+	void log(const uint64_t generation, const double best_error,
+		const double* best, const double* errors, const uint32_t n,
+		const double* population = nullptr);
+
+	//! Same as the other log(), straight from an engine's data.
+	template <class POP_TYPE, std::size_t POP_DIM, class ERROR_TYPE>
+	void log(const uint64_t generation,
+		const std::tuple<ERROR_TYPE,std::array<POP_TYPE,POP_DIM>>& best,
+		const std::vector<ERROR_TYPE>& errors,
+		const std::vector<std::array<POP_TYPE,POP_DIM>>& population) {
+		std::array<double,POP_DIM> b;
+		for (std::size_t d = 0; d < POP_DIM; ++d) {
+			b[d] = static_cast<double>(std::get<1>(best)[d]);
+		}
+		std::vector<double> e(errors.begin(), errors.end());
+		std::vector<double> p;
+		if (wantsPopulation(generation)) {
+			p.reserve(population.size() * POP_DIM);
+			for (auto& x : population) {
+				p.insert(p.end(), x.begin(), x.end());
+			}
+		}
+		log(generation, static_cast<double>(std::get<0>(best)), b.data(),
+			e.data(), e.size(), p.empty() ? nullptr : p.data());
+	}
+
+	//! Writes the queued snapshots and closes the file.
+	/*!
+		Blocks until the writer is done. Later calls to log() are ignored.
+	*/
+	void close();
+
+	//! Snapshots dropped because the queue was full.
+	uint64_t getDropped() const;
+
+private:
+	struct Snapshot {
+		uint64_t generation;
+		double best_error;
+		std::vector<double> best;
+		std::vector<double> errors;
+		std::vector<double> population; // Empty if not saved
+	};
+
+	std::FILE* file_;
+	std::deque<Snapshot> queue_;
+	mutable std::mutex mutex_;
+	std::condition_variable queue_cond_; // Something was queued
+	std::condition_variable space_cond_; // Something was written
+	uint32_t writing_; // Taken from the queue, not written yet
+	bool closing_;
+	bool closed_;
+	uint64_t dropped_;
+	std::string error_; // First I/O error of the writer
+	std::thread writer_;
+
+	void run();
+	void writeBlock(const std::vector<Snapshot>& block);
+	void write(const void* data, const std::size_t size);
+};
+
+//! Thrown when the trajectory file can't be written.
+struct TrajectoryLoggerError : public std::runtime_error {
+	explicit TrajectoryLoggerError(const std::string& what) :
+		std::runtime_error(what) {
+
+	}
+};
+
+} // end namespace pdebc
+
+#endif /* TRAJECTORYLOGGER_HPP_ */
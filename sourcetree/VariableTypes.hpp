@@ -0,0 +1,137 @@
+/*
+ Copyright 2012 Allan Yoshio Hasegawa
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ -----------------------------------------------------------------------------
+ */
+
+
+#ifndef VARIABLETYPES_HPP_
+#define VARIABLETYPES_HPP_
+
+#include <array>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+namespace pdebc {
+
+//! Type of one dimension of the entities.
+enum class VarType {
+	CONTINUOUS, ///< Any value, untouched.
+	INTEGER, ///< Rounded to the nearest integer, clamped to its bounds.
+	CATEGORICAL ///< One of the integers in its bounds, with no order.
+};
+
+//! Per dimension variable types, for mixed-integer problems.
+/*!
+	The differential `a + F * (b - c)` is computed in floating point for
+	every dimension, then each integer dimension is rounded (and clamped
+	to its bounds), and each categorical dimension is rounded and wrapped
+	around its categories. Wrapping instead of clamping keeps the first
+	and last categories from collecting every overshoot, categories have
+	no order to preserve.
+
+	The dimensions are grouped by type once, so the repair runs a tight
+	loop per type instead of a switch per dimension.
+
+	Used by SequentialDE::setVariableTypes() and
+	ThreadsDE::setVariableTypes(). The population type must be floating
+	point, to hold the continuous dimensions.
+
+	\tparam POP_DIM Population dimensions.
+*/
+template <int POP_DIM>
+struct VariableTypes {
+
+	const std::array<VarType,POP_DIM> kTypes_; ///< Type of each dimension.
+	const std::array<double,POP_DIM> kLower_; ///< Lowest value (or category) of each dimension.
+	const std::array<double,POP_DIM> kUpper_; ///< Highest value (or category) of each dimension.
+
+	/*!
+		\param types Type of each dimension.
+		\param lower Lowest value of each integer dimension, and first
+			category of each categorical dimension. Ignored by the
+			continuous ones.
+		\param upper Highest value of each integer dimension, and last
+			category of each categorical dimension. Ignored by the
+			continuous ones.
+	*/
+	VariableTypes(const std::array<VarType,POP_DIM>& types,
+		const std::array<double,POP_DIM>& lower,
+		const std::array<double,POP_DIM>& upper) :
+			kTypes_(types), kLower_(lower), kUpper_(upper) {
+
+		for (int d = 0; d < POP_DIM; ++d) {
+			if (kTypes_[d] == VarType::CONTINUOUS) {
+				continue;
+			}
+			const double lo = std::ceil(kLower_[d]);
+			const double hi = std::floor(kUpper_[d]);
+			if (lo > hi) {
+				throw std::invalid_argument(
+					"VariableTypes: dimension without any integer in its bounds");
+			}
+			if (kTypes_[d] == VarType::INTEGER) {
+				integer_.push_back(Bounds{d, lo, hi, 0});
+			} else {
+				categorical_.push_back(Bounds{d, lo, hi, hi - lo + 1});
+			}
+		}
+	}
+
+	//! True if every dimension is continuous.
+	bool allContinuous() const {
+		return integer_.empty() && categorical_.empty();
+	}
+
+	//! Rounds (and maps) the discrete dimensions of `x`.
+	/*!
+		\return True if `x` changed.
+	*/
+	template <class T>
+	bool repair(std::array<T,POP_DIM>& x) const {
+		bool changed = false;
+		for (auto& b : integer_) {
+			const T v = static_cast<T>(std::min(b.hi,
+				std::max(b.lo, std::round(static_cast<double>(x[b.d])))));
+			changed |= v != x[b.d];
+			x[b.d] = v;
+		}
+		for (auto& b : categorical_) {
+			double v = std::round(static_cast<double>(x[b.d])) - b.lo;
+			v -= b.n * std::floor(v / b.n);
+			const T c = static_cast<T>(b.lo + v);
+			changed |= c != x[b.d];
+			x[b.d] = c;
+		}
+		return changed;
+	}
+
+private:
+	struct Bounds {
+		int d;
+		double lo;
+		double hi;
+		double n; // Categories
+	};
+
+	std::vector<Bounds> integer_;
+	std::vector<Bounds> categorical_;
+};
+
+} // end namespace pdebc
+
+#endif /* VARIABLETYPES_HPP_ */